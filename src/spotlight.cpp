@@ -10,6 +10,7 @@
  */
 #include "spotlight/config/file.hpp"
 #include <chrono>
+#include <csignal>
 #include <iostream>
 #include <getopt.h>
 
@@ -21,21 +22,56 @@
 #include <spotlight/pipeline/pipeline.hpp>
 
 
-int main(int argc, char **argv)
+using steady = std::chrono::steady_clock;
+
+inline double elapsed_ms(const steady::time_point& start)
 {
-  // Default Configurations
-  spotlight::PipelineConfig cfg;
+  return std::chrono::duration<double, std::milli>(steady::now() - start).count();
+}
 
-  // Conf File
-  spotlight::parse_config_file(CONF_FILE, cfg);
-  
-  // Get Configuration from CLI
-  spotlight::parse_args(argc, argv, cfg);
+// SIGHUP: re-read the conf file between two frames
+static volatile std::sig_atomic_t reload_conf = 0;
+
+inline void on_sighup(int)
+{
+  reload_conf = 1;
+}
+
+/**
+ * Settings that apply on the fly, from the conf file: segm-w / segm-h
+ * (the rest needs a restart).
+ */
+template <typename SegmType, typename FaceType>
+void reload(
+  const spotlight::PipelineConfig& cfg,
+  spotlight::Pipeline<SegmType, FaceType>& pipeline
+)
+{
+  spotlight::PipelineConfig next = cfg;
+  spotlight::parse_config_file(CONF_FILE, next);
+  if (next.segm_w <= 0 || next.segm_h <= 0)
+    return;
+
+  if (pipeline.setSegmResolution(next.segm_w, next.segm_h))
+    std::cout << "segm input: " << next.segm_w << "x" << next.segm_h << std::endl;
+  else
+    spotlight::log_err("segm-model can not run at the new segm-w x segm-h!!!");
+}
+
+template <typename SegmType, typename FaceType>
+void run(const spotlight::PipelineConfig& cfg)
+{
+  const auto launch = steady::now();
 
   // Initialize Pipeline
-  spotlight::Pipeline pipeline(cfg);
+  auto stage = steady::now();
+  spotlight::Pipeline<SegmType, FaceType> pipeline(cfg);
+  const double pipeline_ms = elapsed_ms(stage);
+
+  stage = steady::now();
   spotlight::V4L2Camera cam(cfg.in_dev, cfg.InpConfig());
   spotlight::V4L2VirtualCamera vcam(cfg.out_dev, cfg.OutConfig());
+  const double device_ms = elapsed_ms(stage);
 
   // Allocate Required Buffers
   // TODO: Use you own allocator
@@ -46,22 +82,103 @@ int main(int argc, char **argv)
   uint8_t *inp_u = vec_inp_u.data();
   uint8_t *out_u = vec_out_u.data();
 
+  // Both devices YUV underneath: composite on the planes (no FRAME mode)
+  const bool yuv = (
+    cfg.yuv && cfg.mode != spotlight::PipelineMode::FRAME &&
+    cam.converter->NativeYUV() && vcam.converter->NativeYUV()
+  );
+  spotlight::YUVFrame inp_yuv, out_yuv;
+  std::signal(SIGHUP, on_sighup);
+
   try
   {
-    using clock = std::chrono::steady_clock;
-    for (;;)
+    for (bool first = true;; first = false)
     {
-      auto start = clock::now();
-      cam.invoke(inp_u);
-      pipeline.invoke(inp_u, out_u);
-      vcam.invoke(out_u);
-      std::cout << std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start).count() << " ms" << std::endl;
+      if (reload_conf)
+      {
+        reload_conf = 0;
+        reload(cfg, pipeline);
+      }
+
+      auto start = steady::now();
+      // MJPEG: the analysis image is decoded scaled, next to the frame
+      const spotlight::ScaledTarget* scaled = pipeline.scaledTarget();
+      if (yuv)
+      {
+        const bool ready = cam.invokeYUV(inp_yuv, scaled);
+        pipeline.invokeYUV(inp_yuv, out_yuv, ready);
+        vcam.invokeYUV(out_yuv);
+      }
+      else
+      {
+        const bool ready = cam.invoke(inp_u, pipeline.inputRegion(), scaled);
+        pipeline.invoke(inp_u, out_u, ready);
+        vcam.invoke(out_u);
+      }
+      std::cout << std::chrono::duration_cast<std::chrono::milliseconds>(steady::now() - start).count() << " ms" << std::endl;
+
+      if (first)
+      {
+        std::cout << "time to first frame: " << elapsed_ms(launch) << " ms"
+                  << " (pipeline " << pipeline_ms << " ms"
+                  << ", device init " << device_ms << " ms)" << std::endl;
+        for (const auto& [name, t] : pipeline.modelTimings())
+        {
+          std::cout << "  " << name << ": model load " << t.load << " ms"
+                    << ", delegate " << t.delegate << " ms"
+                    << ", tensor alloc " << t.allocate << " ms" << std::endl;
+        }
+      }
     }
   }
   catch (...)
   {
     throw;
   }
+}
+
+
+template <typename SegmType>
+void run_face(const spotlight::PipelineConfig& cfg)
+{
+  switch (cfg.face_precision)
+  {
+    case spotlight::ModelPrecision::FLOAT:
+      run<SegmType, float>(cfg);
+      break;
+    case spotlight::ModelPrecision::UINT8:
+      run<SegmType, uint8_t>(cfg);
+      break;
+    case spotlight::ModelPrecision::INT8:
+      run<SegmType, int8_t>(cfg);
+      break;
+  }
+}
+
+
+int main(int argc, char **argv)
+{
+  // Default Configurations
+  spotlight::PipelineConfig cfg;
+
+  // Conf File
+  spotlight::parse_config_file(CONF_FILE, cfg);
+  
+  // Get Configuration from CLI
+  spotlight::parse_args(argc, argv, cfg);
+
+  switch (cfg.segm_precision)
+  {
+    case spotlight::ModelPrecision::FLOAT:
+      run_face<float>(cfg);
+      break;
+    case spotlight::ModelPrecision::UINT8:
+      run_face<uint8_t>(cfg);
+      break;
+    case spotlight::ModelPrecision::INT8:
+      run_face<int8_t>(cfg);
+      break;
+  }
 
   return 0;
 }
@@ -29,6 +29,9 @@ inline void parse_args(
   static struct option long_opts[] = {
     {"mode", required_argument, nullptr, 'm'},
     {"n-threads", required_argument, nullptr, 'n'},
+    {"xnnpack", required_argument, nullptr, 19},
+    {"xnnpack-fp16", required_argument, nullptr, 20},
+    {"xnnpack-cache", required_argument, nullptr, 21},
 
     {"in-dev", required_argument, nullptr, 'i'},
     {"in-fmt", required_argument, nullptr, 3},
@@ -44,6 +47,35 @@ inline void parse_args(
 
     {"bg-img", required_argument, nullptr, 'b'},
 
+    {"segm-model", required_argument, nullptr, 16},
+    {"segm-precision", required_argument, nullptr, 17},
+    {"segm-ref-model", required_argument, nullptr, 18},
+    {"segm-w", required_argument, nullptr, 22},
+    {"segm-h", required_argument, nullptr, 23},
+    {"segm-roi", required_argument, nullptr, 24},
+    {"segm-roi-pad", required_argument, nullptr, 25},
+    {"segm-roi-refresh", required_argument, nullptr, 26},
+    {"segm-interval", required_argument, nullptr, 27},
+    {"segm-motion", required_argument, nullptr, 28},
+    {"segm-interpreters", required_argument, nullptr, 29},
+
+    {"face", required_argument, nullptr, 30},
+    {"face-model", required_argument, nullptr, 37},
+    {"face-precision", required_argument, nullptr, 38},
+    {"face-interval", required_argument, nullptr, 31},
+    {"face-track", required_argument, nullptr, 32},
+
+    {"sched-budget", required_argument, nullptr, 33},
+    {"sched-still", required_argument, nullptr, 34},
+
+    {"yuv", required_argument, nullptr, 35},
+    {"mjpeg-threads", required_argument, nullptr, 36},
+
+    {"mask-morph", required_argument, nullptr, 12},
+    {"mask-morph-radius", required_argument, nullptr, 13},
+    {"mask-feather", required_argument, nullptr, 14},
+    {"mask-feather-radius", required_argument, nullptr, 15},
+
     {nullptr, 0, nullptr, 0}
   };
 
@@ -72,6 +104,33 @@ inline void parse_args(
     case 9:
     case 10:
     case 11:
+    case 12:
+    case 13:
+    case 14:
+    case 15:
+    case 16:
+    case 17:
+    case 18:
+    case 19:
+    case 20:
+    case 21:
+    case 22:
+    case 23:
+    case 24:
+    case 25:
+    case 26:
+    case 27:
+    case 28:
+    case 29:
+    case 30:
+    case 31:
+    case 32:
+    case 33:
+    case 34:
+    case 35:
+    case 36:
+    case 37:
+    case 38:
       cfg.set(long_opts[long_index].name, optarg);
       break;
     default:
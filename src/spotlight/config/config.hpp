@@ -12,6 +12,7 @@
 #define CONFIG_HPP
 
 #include <string>
+#include <algorithm>
 #include <cstdint>
 #include <spotlight/config/defaults.hpp>
 #include <spotlight/utils/error_utils.hpp>
@@ -29,6 +30,26 @@ enum class PipelineMode {
   BLUR,
   IMAGE,
   VIDEO, // TODO: SUPPORT THIS!
+  FRAME, // Auto framing around the face, no segmentation
+};
+
+enum class ModelPrecision {
+  FLOAT,
+  UINT8,
+  INT8,
+};
+
+enum class MaskMorph {
+  NONE,
+  ERODE,
+  DILATE,
+  OPEN,
+  CLOSE,
+};
+
+enum class MaskFeather {
+  GAUSSIAN,
+  DISTANCE,
 };
 
 struct DeviceConfig
@@ -37,6 +58,7 @@ struct DeviceConfig
   int width;
   int height;
   double fps;
+  int codec_threads = 1;
 
   bool operator==(const DeviceConfig& other) const
   {
@@ -54,12 +76,24 @@ struct DeviceConfig
   }
 };
 
+struct InferenceConfig
+{
+  int n_threads;
+  bool xnnpack;
+  bool xnnpack_fp16;
+  bool xnnpack_cache;
+};
+
 
 struct PipelineConfig
 {
   PipelineMode mode = MODE;
   int n_threads = N_THREADS;
 
+  bool xnnpack = XNNPACK;
+  bool xnnpack_fp16 = XNNPACK_FP16;
+  bool xnnpack_cache = XNNPACK_CACHE;
+
   int in_w = IN_W;
   int in_h = IN_H;
   int out_w = OUT_W;
@@ -75,6 +109,36 @@ struct PipelineConfig
   std::string out_dev = OUT_DEV;
   std::string bg_img = BG_IMG;
 
+  std::string segm_model = SEGM_MODEL;
+  ModelPrecision segm_precision = SEGM_PRECISION;
+  std::string segm_ref_model = SEGM_REF_MODEL;
+  int segm_w = SEGM_W;
+  int segm_h = SEGM_H;
+  bool segm_roi = SEGM_ROI;
+  float segm_roi_pad = SEGM_ROI_PAD;
+  int segm_roi_refresh = SEGM_ROI_REFRESH;
+  int segm_interval = SEGM_INTERVAL;
+  bool segm_motion = SEGM_MOTION;
+  int segm_interpreters = SEGM_INTERPRETERS;
+
+  bool face = FACE;
+  std::string face_model = FACE_MODEL;
+  ModelPrecision face_precision = FACE_PRECISION;
+  int face_interval = FACE_INTERVAL;
+  int face_track = FACE_TRACK;
+
+  float sched_budget = SCHED_BUDGET;
+  float sched_still = SCHED_STILL;
+
+  bool yuv = YUV;
+  int mjpeg_threads = MJPEG_THREADS;
+
+  MaskMorph mask_morph = MASK_MORPH;
+  int mask_morph_radius = MASK_MORPH_RADIUS;
+
+  MaskFeather mask_feather = MASK_FEATHER;
+  float mask_feather_radius = MASK_FEATHER_RADIUS;
+
 
   int InpPixels() const { return in_w * in_h; }
   int OutPixels() const { return out_w * out_h; }
@@ -85,7 +149,8 @@ struct PipelineConfig
       in_fmt,
       in_w,
       in_h,
-      in_fps
+      in_fps,
+      mjpeg_threads
     };
   }
 
@@ -95,7 +160,18 @@ struct PipelineConfig
       out_fmt,
       out_w,
       out_h,
-      out_fps
+      out_fps,
+      mjpeg_threads
+    };
+  }
+
+  InferenceConfig InferConfig() const
+  {
+    return {
+      n_threads,
+      xnnpack,
+      xnnpack_fp16,
+      xnnpack_cache
     };
   }
 
@@ -109,6 +185,8 @@ struct PipelineConfig
         mode = PipelineMode::IMAGE;
       else if (value == "video")
         mode = PipelineMode::VIDEO;
+      else if (value == "frame")
+        mode = PipelineMode::FRAME;
       else
         throw_err("Invalid PipelineMode: " + value);
     }
@@ -116,6 +194,18 @@ struct PipelineConfig
     {
       n_threads = std::stoi(value);
     }
+    else if (key == "xnnpack")
+    {
+      xnnpack = std::stoi(value);
+    }
+    else if (key == "xnnpack-fp16")
+    {
+      xnnpack_fp16 = std::stoi(value);
+    }
+    else if (key == "xnnpack-cache")
+    {
+      xnnpack_cache = std::stoi(value);
+    }
     else if (key == "in-w")
     {
       in_w = std::stoi(value);
@@ -160,6 +250,132 @@ struct PipelineConfig
     {
       bg_img = value;
     }
+    else if (key == "segm-model")
+    {
+      segm_model = value;
+    }
+    else if (key == "segm-precision")
+    {
+      if (value == "float")
+        segm_precision = ModelPrecision::FLOAT;
+      else if (value == "uint8")
+        segm_precision = ModelPrecision::UINT8;
+      else if (value == "int8")
+        segm_precision = ModelPrecision::INT8;
+      else
+        throw_err("Invalid ModelPrecision: " + value);
+    }
+    else if (key == "segm-ref-model")
+    {
+      segm_ref_model = value;
+    }
+    else if (key == "segm-w")
+    {
+      segm_w = std::stoi(value);
+    }
+    else if (key == "segm-h")
+    {
+      segm_h = std::stoi(value);
+    }
+    else if (key == "segm-roi")
+    {
+      segm_roi = std::stoi(value);
+    }
+    else if (key == "segm-roi-pad")
+    {
+      segm_roi_pad = std::stof(value);
+    }
+    else if (key == "segm-roi-refresh")
+    {
+      segm_roi_refresh = std::stoi(value);
+    }
+    else if (key == "segm-interval")
+    {
+      segm_interval = std::max(1, std::stoi(value));
+    }
+    else if (key == "segm-motion")
+    {
+      segm_motion = std::stoi(value);
+    }
+    else if (key == "segm-interpreters")
+    {
+      segm_interpreters = std::max(1, std::stoi(value));
+    }
+    else if (key == "face")
+    {
+      face = std::stoi(value);
+    }
+    else if (key == "face-model")
+    {
+      face_model = value;
+    }
+    else if (key == "face-precision")
+    {
+      if (value == "float")
+        face_precision = ModelPrecision::FLOAT;
+      else if (value == "uint8")
+        face_precision = ModelPrecision::UINT8;
+      else if (value == "int8")
+        face_precision = ModelPrecision::INT8;
+      else
+        throw_err("Invalid ModelPrecision: " + value);
+    }
+    else if (key == "face-interval")
+    {
+      face_interval = std::max(1, std::stoi(value));
+    }
+    else if (key == "face-track")
+    {
+      face_track = std::max(0, std::stoi(value));
+    }
+    else if (key == "sched-budget")
+    {
+      sched_budget = std::max(0.f, std::stof(value));
+    }
+    else if (key == "sched-still")
+    {
+      sched_still = std::max(0.f, std::stof(value));
+    }
+    else if (key == "yuv")
+    {
+      yuv = std::stoi(value);
+    }
+    else if (key == "mjpeg-threads")
+    {
+      mjpeg_threads = std::max(1, std::stoi(value));
+    }
+    else if (key == "mask-morph")
+    {
+      if (value == "none")
+        mask_morph = MaskMorph::NONE;
+      else if (value == "erode")
+        mask_morph = MaskMorph::ERODE;
+      else if (value == "dilate")
+        mask_morph = MaskMorph::DILATE;
+      else if (value == "open")
+        mask_morph = MaskMorph::OPEN;
+      else if (value == "close")
+        mask_morph = MaskMorph::CLOSE;
+      else
+        throw_err("Invalid MaskMorph: " + value);
+    }
+    else if (key == "mask-morph-radius")
+    {
+      mask_morph_radius = std::max(0, std::stoi(value));
+    }
+    else if (key == "mask-feather")
+    {
+      if (value == "gaussian")
+        mask_feather = MaskFeather::GAUSSIAN;
+      else if (value == "distance")
+        mask_feather = MaskFeather::DISTANCE;
+      else
+        throw_err("Invalid MaskFeather: " + value);
+    }
+    else if (key == "mask-feather-radius")
+    {
+      mask_feather_radius = std::stof(value);
+    }
     else
       throw_err("Invalid Option: " + key);
   }
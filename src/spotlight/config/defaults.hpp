@@ -19,6 +19,10 @@
 #define MODE                     PipelineMode::BLUR
 #define N_THREADS                1
 
+#define XNNPACK                  1
+#define XNNPACK_FP16             0
+#define XNNPACK_CACHE            1
+
 #define IN_DEV                   "/dev/video0"
 #define IN_FMT                   V4L2_PIX_FMT_MJPEG
 #define IN_W                     1280
@@ -33,30 +37,65 @@
 
 #define BG_IMG                   "assets/background.png"
 
+#define SEGM_MODEL               "models/segm/segm_lite_v681.tflite"
+#define SEGM_PRECISION           ModelPrecision::FLOAT
+#define SEGM_REF_MODEL           ""
+#define SEGM_W                   0    // 0: model's own input size
+#define SEGM_H                   0
+#define SEGM_ROI                 0
+#define SEGM_ROI_PAD             0.15
+#define SEGM_ROI_REFRESH         30
+#define SEGM_INTERVAL            1    // run segmentation every N frames
+#define SEGM_MOTION              1
+#define SEGM_INTERPRETERS        1
+
+#define FACE                     0
+#define FACE_MODEL               "models/face/face_smpl_320p.tflite"
+#define FACE_PRECISION           ModelPrecision::FLOAT
+#define FACE_INTERVAL            5    // run face detection every N frames
+#define FACE_TRACK               30   // every N while tracking (0: no tracker)
+
+#define SCHED_BUDGET             0    // inference ms per frame (0: no limit)
+#define SCHED_STILL              0    // mean luma change to rerun (0: always)
+
+#define YUV                      1    // YUV planes end to end when both ends allow
+
+#define MASK_MORPH               MaskMorph::NONE
+#define MASK_MORPH_RADIUS        1
+#define MASK_FEATHER             MaskFeather::GAUSSIAN
+#define MASK_FEATHER_RADIUS      8.0
+
 #define MASK_FILTER_RADIUS       2
 #define EDGE_FILTER_RADIUS       3
 #define BLUR_FILTER_RADIUS       3
 #define BLUR_FILTER_COMPONENTS   2
 #define BLUR_FILTER_TRANSITION   0.4
+#define MOTION_FILTER_RADIUS     4
+#define MOTION_FILTER_BLOCK      8
 
 #define MJPEG_Q                  95
+#define MJPEG_THREADS            1    // slices per MJPEG frame, a thread each
 
 
 // Unconfigurable (For Now)
 #define CONF_FILE                "/etc/spotlight.conf"
+#define STATS_INTERVAL           100
 
-#define FACE_MODEL              "models/face/face_smpl_320p.tflite"
 #define FACE_TOPK                10
 #define SCORE_THRESHOLD          0.8
 #define IOU_THRESHOLD            0.2
 #define TEMPORAL_ALPHA           0.9
 #define JERK_THRESHOLD           0.3
+#define FACE_TRACK_Q             0.02 // noises, in face widths
+#define FACE_TRACK_R             0.05
+#define FACE_TRACK_JUMP          0.5
 #define FRAME_PAD_U              0.50
 #define FRAME_PAD_D              0.25
 #define FRAME_PAD_L              0.50
 #define FRAME_PAD_R              0.50
-
-#define SEGM_MODEL               "models/segm/segm_lite_v681.tflite"
+#define FRAME_EASE               0.15 // per frame step towards the face
+#define FRAME_GRID               8    // crop sizes step, in input pixels
+#define FRAME_MAX_ZOOM           3.0
 
 
 #endif // DEFAULTS_HPP
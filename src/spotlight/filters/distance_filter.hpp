@@ -0,0 +1,167 @@
+/**
+ * @file distance_filter.hpp
+ * @author Ranjodh Singh
+ *
+ * @brief DISTANCE_FILTER. (https://cs.brown.edu/people/pfelzens/dt/)
+ *
+ * Copyright (c) 2026 Ranjodh Singh
+ * This file is licensed under the MIT License.
+ * You may obtain a copy of the License at https://opensource.org/license/MIT.
+ */
+#ifndef DISTANCE_FILTER_HPP
+#define DISTANCE_FILTER_HPP
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+
+namespace spotlight {
+
+/**
+ * Feathers a mask with a signed euclidean distance ramp.
+ *
+ * The exact squared EDT (Felzenszwalb-Huttenlocher lower envelope of
+ * parabolas) is taken to the foreground and to the background, one column
+ * pass and one row pass each, so the cost is linear in the pixel count for
+ * any feather radius. Output is 0.5 on the mask boundary, reaching 0 and 1
+ * at `radius` pixels outside and inside it.
+ */
+class DistanceFilter
+{
+ public:
+  DistanceFilter(
+    const float radius,
+    const int width,
+    const int height,
+    const int channels
+  )
+    : radius(radius), width(width), height(height), channels(channels)
+  {
+    const int n = std::max(width, height);
+    line_f.resize(n);
+    line_d.resize(n);
+    line_v.resize(n);
+    line_z.resize(n + 1);
+
+    dist_fg.resize(height * width * channels);
+    dist_bg.resize(height * width * channels);
+  }
+
+  /* inp and out may alias, inp is thresholded at `threshold`. */
+  template <typename iT, typename oT>
+  void invoke(
+    const iT* inp,
+    oT* out,
+    const float threshold = 0.5f,
+    const float scale = 1.f
+  )
+  {
+    const int n = height * width * channels;
+    for (int i = 0; i < n; i++)
+    {
+      const bool fg = inp[i] > threshold;
+      dist_fg[i] = fg ? 0.f : INF;
+      dist_bg[i] = fg ? INF : 0.f;
+    }
+
+    transform(dist_fg.data());
+    transform(dist_bg.data());
+
+    // Pixel centers are half a pixel away from the boundary.
+    const float slope = 0.5f / std::max(radius, 1e-3f);
+    for (int i = 0; i < n; i++)
+    {
+      const float sd = (dist_fg[i] == 0.f)
+                     ? sqrtf(dist_bg[i]) - 0.5f
+                     : 0.5f - sqrtf(dist_fg[i]);
+      out[i] = (oT)(scale * std::clamp(0.5f + sd * slope, 0.f, 1.f));
+    }
+  }
+
+  /* In place 2D squared EDT of a 0 / INF image. */
+  void transform(float* img)
+  {
+    for (int c = 0; c < channels; c++)
+    {
+      for (int x = 0; x < width; x++)
+      {
+        float* col = img + x * channels + c;
+        const int step = width * channels;
+        for (int y = 0; y < height; y++)
+          line_f[y] = col[y * step];
+        transform1D(height);
+        for (int y = 0; y < height; y++)
+          col[y * step] = line_d[y];
+      }
+
+      for (int y = 0; y < height; y++)
+      {
+        float* row = img + y * width * channels + c;
+        for (int x = 0; x < width; x++)
+          line_f[x] = row[x * channels];
+        transform1D(width);
+        for (int x = 0; x < width; x++)
+          row[x * channels] = line_d[x];
+      }
+    }
+  }
+
+  /* line_d[q] = min_p (q - p)^2 + line_f[p] */
+  void transform1D(const int n)
+  {
+    const float* f = line_f.data();
+    float* d = line_d.data();
+    int* v = line_v.data();
+    float* z = line_z.data();
+
+    int k = 0;
+    v[0] = 0;
+    z[0] = -INF;
+    z[1] = +INF;
+    for (int q = 1; q < n; q++)
+    {
+      float s = intersect(f, q, v[k]);
+      while (s <= z[k])
+        s = intersect(f, q, v[--k]);
+      k++;
+      v[k] = q;
+      z[k] = s;
+      z[k + 1] = +INF;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; q++)
+    {
+      while (z[k + 1] < q)
+        k++;
+      const float dq = (float)(q - v[k]);
+      d[q] = dq * dq + f[v[k]];
+    }
+  }
+
+  /* Abscissa where the parabolas rooted at p and q intersect. */
+  static inline float intersect(const float* f, const int q, const int p)
+  {
+    return ((f[q] + q * q) - (f[p] + p * p)) / (2.f * (q - p));
+  }
+
+
+  std::vector<float> line_f;
+  std::vector<float> line_d;
+  std::vector<int> line_v;
+  std::vector<float> line_z;
+  std::vector<float> dist_fg;
+  std::vector<float> dist_bg;
+
+  const float radius;
+  const int width;
+  const int height;
+  const int channels;
+
+  static constexpr float INF = 1e20f;
+};
+
+} // namespace spotlight
+
+#endif // DISTANCE_FILTER_HPP
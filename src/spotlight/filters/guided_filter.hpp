@@ -15,12 +15,17 @@
 #include <vector>
 #include <algorithm>
 
-#include <spotlight/utils/image_utils.hpp>
-#include <spotlight/filters/box_filter.hpp>
-
 
 namespace spotlight {
 
+/**
+ * Row streaming guided filter.
+ *
+ * Box means are running sums: along x within a row, and along y over a ring
+ * of the last 2r+2 horizontally summed rows. Each A/B row is pushed straight
+ * into a second ring, so meanA/meanB (and the output) trail the input by r
+ * rows. Memory is O(r * W) instead of eight full frames.
+ */
 class GuidedFilter
 {
  public:
@@ -32,16 +37,30 @@ class GuidedFilter
     const int channels
   )
     : radius(radius), eps(eps), width(width), height(height),
-      channels(channels), box_filter(radius, width, height, channels)
+      channels(channels)
   {
-    meanI.resize(height * width * channels);
-    meanP.resize(height * width * channels);
-    corrI.resize(height * width * channels);
-    corrIp.resize(height * width * channels);
-    A.resize(height * width * channels);
-    B.resize(height * width * channels);
-    meanA.resize(height * width * channels);
-    meanB.resize(height * width * channels);
+    krad = (int)radius;
+    kernel_size = 2 * krad + 1;
+    kernel_value = 1.0 / (kernel_size * kernel_size);
+    ring_size = 2 * krad + 2;
+    stride = width * channels;
+
+    ringI.resize(ring_size * stride);
+    ringP.resize(ring_size * stride);
+    ringII.resize(ring_size * stride);
+    ringIP.resize(ring_size * stride);
+    ringA.resize(ring_size * stride);
+    ringB.resize(ring_size * stride);
+
+    sumI.resize(stride);
+    sumP.resize(stride);
+    sumII.resize(stride);
+    sumIP.resize(stride);
+    sumA.resize(stride);
+    sumB.resize(stride);
+
+    rowA.resize(stride);
+    rowB.resize(stride);
   }
 
   template <typename iT, typename gT, typename oT>
@@ -53,55 +72,152 @@ class GuidedFilter
     float clamp_hi = 1.0f
   )
   {
-    box_filter.invoke(I, meanI.data());
-    box_filter.invoke(P, meanP.data());
-
-    box_filter.invoke(
-      [&](int idx) {return (float)I[idx] * I[idx];},
-      [&](int idx, float val) { corrI[idx] = val;}
-    );
-    box_filter.invoke(
-      [&](int idx) {return (float)I[idx] * P[idx];},
-      [&](int idx, float val) { corrIp[idx] = val;}
-    );
-
-    for (int i = 0; i < height * width * channels; i++)
+    // y: input rows read, y_ab: A/B rows produced, y_q: output rows written
+    int y_ab = 0, y_q = 0;
+    for (int y = 0; y < height; y++)
     {
-      A[i] = (corrIp[i] - meanI[i] * meanP[i]) /
-             ((corrI[i] - meanI[i] * meanI[i]) + eps);
-      B[i] = meanP[i] - A[i] * meanI[i];
+      const iT* rI = I + y * stride;
+      const gT* rP = P + y * stride;
+      boxRow([&](int i) {return (float)rI[i];}, slot(ringI, y));
+      boxRow([&](int i) {return (float)rP[i];}, slot(ringP, y));
+      boxRow([&](int i) {return (float)rI[i] * rI[i];}, slot(ringII, y));
+      boxRow([&](int i) {return (float)rI[i] * rP[i];}, slot(ringIP, y));
+
+      while (y_ab < height && lastRow(y_ab) <= y)
+      {
+        slideSum(ringI, sumI, y_ab);
+        slideSum(ringP, sumP, y_ab);
+        slideSum(ringII, sumII, y_ab);
+        slideSum(ringIP, sumIP, y_ab);
+
+        for (int i = 0; i < stride; i++)
+        {
+          const double meanI = sumI[i] * kernel_value;
+          const double meanP = sumP[i] * kernel_value;
+          const double corrI = sumII[i] * kernel_value;
+          const double corrIp = sumIP[i] * kernel_value;
+
+          const double A = (corrIp - meanI * meanP) /
+                           ((corrI - meanI * meanI) + eps);
+          rowA[i] = (float)A;
+          rowB[i] = (float)(meanP - A * meanI);
+        }
+
+        const float* rA = rowA.data();
+        const float* rB = rowB.data();
+        boxRow([&](int i) {return rA[i];}, slot(ringA, y_ab));
+        boxRow([&](int i) {return rB[i];}, slot(ringB, y_ab));
+
+        while (y_q < height && lastRow(y_q) <= y_ab)
+        {
+          slideSum(ringA, sumA, y_q);
+          slideSum(ringB, sumB, y_q);
+
+          const iT* qI = I + y_q * stride;
+          oT* dst = Q + y_q * stride;
+          for (int i = 0; i < stride; i++)
+          {
+            const float meanA = (float)(sumA[i] * kernel_value);
+            const float meanB = (float)(sumB[i] * kernel_value);
+            dst[i] = (oT)std::clamp(
+              meanA * qI[i] + meanB, clamp_lo, clamp_hi
+            );
+          }
+          y_q++;
+        }
+        y_ab++;
+      }
     }
+  }
 
-    box_filter.invoke<float, float>(A.data(), meanA.data());
-    box_filter.invoke<float, float>(B.data(), meanB.data());
+  /* Last source row needed by the vertical window centered at row y. */
+  inline int lastRow(const int y) const
+  {
+    return std::min(y + krad, height - 1);
+  }
 
-    // TODO: Does this need a clamp?
-    for (int i = 0; i < height * width * channels; i++)
+  inline float* slot(std::vector<float>& ring, const int row)
+  {
+    return &ring[(row % ring_size) * stride];
+  }
+
+  /* Horizontal running box sum of one row (unnormalized). */
+  template <typename F>
+  void boxRow(const F func, float* dst)
+  {
+    for (int c = 0; c < channels; c++)
+    {
+      double acc = 0.0;
+      for (int xk = -krad; xk <= krad; xk++)
+        acc += func(reflect(xk, width) * channels + c);
+      dst[c] = (float)acc;
+
+      for (int x = 1; x < width; x++)
+      {
+        acc += func(reflect(x + krad, width) * channels + c);
+        acc -= func(reflect(x - krad - 1, width) * channels + c);
+        dst[x * channels + c] = (float)acc;
+      }
+    }
+  }
+
+  /* Moves the vertical running sum to the window centered at row y. */
+  void slideSum(std::vector<float>& ring, std::vector<double>& sum, const int y)
+  {
+    if (y == 0)
     {
-      Q[i] = (oT)std::clamp(
-        meanA[i] * I[i] + meanB[i], clamp_lo, clamp_hi
-      );
+      std::fill(sum.begin(), sum.end(), 0.0);
+      for (int yk = -krad; yk <= krad; yk++)
+      {
+        const float* src = slot(ring, reflect(yk, height));
+        for (int i = 0; i < stride; i++)
+          sum[i] += src[i];
+      }
+      return;
     }
+
+    const float* add = slot(ring, reflect(y + krad, height));
+    const float* sub = slot(ring, reflect(y - krad - 1, height));
+    for (int i = 0; i < stride; i++)
+      sum[i] += (double)add[i] - sub[i];
+  }
+
+  inline int reflect(const int i, const int lim)
+  {
+    return i < 0 ? -i - 1 : (i >= lim ? 2 * lim - i - 1 : i);
   }
 
 
-  // TODO: FLOAT TAKES 4 BYTES :(
-  // A MAJOR MAJOR MEMORY CONSUMER
-  std::vector<float> meanI;
-  std::vector<float> meanP;
-  std::vector<float> corrI;
-  std::vector<float> corrIp;
-  std::vector<float> A;
-  std::vector<float> B;
-  std::vector<float> meanA;
-  std::vector<float> meanB;
+  int krad;
+  int stride;
+  int ring_size;
+  int kernel_size;
+  double kernel_value;
+
+  // Horizontally summed rows, ring_size rows each.
+  std::vector<float> ringI;
+  std::vector<float> ringP;
+  std::vector<float> ringII;
+  std::vector<float> ringIP;
+  std::vector<float> ringA;
+  std::vector<float> ringB;
+
+  // Vertical running sums, one row each.
+  std::vector<double> sumI;
+  std::vector<double> sumP;
+  std::vector<double> sumII;
+  std::vector<double> sumIP;
+  std::vector<double> sumA;
+  std::vector<double> sumB;
+
+  std::vector<float> rowA;
+  std::vector<float> rowB;
 
   const float radius;
   const float eps;
   const int width;
   const int height;
   const int channels;
-  BoxFilter box_filter;
 };
 
 } // namespace spotlight
@@ -29,31 +29,33 @@ class LOGFilter
     // Note: sigma < 1 (radius < 3) can be unstable
     sigma = radius / 3.f;
     kernel_size = 2 * radius + 1;
-    kernel.resize(kernel_size * kernel_size);
 
     const double pi = M_PI;
     const double sigmaSq = sigma * sigma;
     const double scale_a = 1.0 / (2  * sigmaSq);
-    const double scale_b = 1.0 / (pi * sigmaSq * sigmaSq);
 
-    int k_idx = 0;
-    double sum = 0.0;
-    for (int y = -radius; y <= radius; y++)
+    // LoG(x, y) = g''(x) g(y) + g(x) g''(y)
+    // Zero sum g'' keeps the separable kernel zero sum too.
+    kernel_g.resize(kernel_size);
+    kernel_d.resize(kernel_size);
+    const double scale_g = 1.0 / (sqrt(2 * pi) * sigma);
+    double sum_d = 0.0;
+    for (int i = -radius; i <= radius; i++)
     {
-      for (int x = -radius; x <= radius; x++)
-      {
-        const float tmp = (y*y + x*x) * scale_a;
-        const float val = scale_b * (tmp - 1) * expf(-tmp);
-        kernel[k_idx++] = val;
-        sum += val;
-      }
+      const double g = scale_g * exp(-(i * i) * scale_a);
+      const double d = (i * i / sigmaSq - 1.0) / sigmaSq * g;
+      kernel_g[i + radius] = g;
+      kernel_d[i + radius] = d;
+      sum_d += d;
     }
+    for (auto &i: kernel_d)
+      i -= sum_d / kernel_size;
 
-    const float mean = sum / (kernel_size * kernel_size);
-    for (auto &i: kernel)
-        i -= mean;
+    buffer_g.resize(height * width * channels);
+    buffer_d.resize(height * width * channels);
   }
 
+  /* Separable LoG, O(r) per pixel. */
   template<typename iT, typename oT>
   void invoke(
     const iT* input,
@@ -62,28 +64,43 @@ class LOGFilter
     const double clamp_hi = 1.0
   )
   {
-    oT* dst = output;
+    int idx = 0;
     for (int y = 0; y < height; y++)
     {
       for (int x = 0; x < width; x++)
       {
         for (int c = 0; c < channels; c++)
         {
-          int k_idx = 0;
-          double sum = 0.0;
-          for (int yk = -radius; yk <= radius; yk++)
+          float sum_g = 0.f, sum_d = 0.f;
+          for (int i = -radius; i <= radius; i++)
           {
-            for (int xk = -radius; xk <= radius; xk++)
-            {
-              const int yi = reflect(y + yk, height);
-              const int xi = reflect(x + xk, width);
-              const int cur_idx = (yi * width + xi) * channels + c;
-
-               sum += kernel[k_idx++] * input[cur_idx];
-            }
+            const int sx = reflect(x + i, width);
+            const float val = input[(y * width + sx) * channels + c];
+            sum_g += kernel_g[i + radius] * val;
+            sum_d += kernel_d[i + radius] * val;
           }
-          *(dst++) = (oT)std::clamp(sum, clamp_lo, clamp_hi);
+          buffer_g[idx] = sum_g;
+          buffer_d[idx] = sum_d;
+          idx++;
+        }
+      }
+    }
+
+    const float lo = clamp_lo, hi = clamp_hi;
+    const int stride = width * channels;
+    for (int y = 0; y < height; y++)
+    {
+      oT* dst = output + y * stride;
+      for (int i = 0; i < stride; i++)
+      {
+        float sum = 0.f;
+        for (int k = -radius; k <= radius; k++)
+        {
+          const int src = reflect(y + k, height) * stride + i;
+          sum += kernel_d[k + radius] * buffer_g[src]
+               + kernel_g[k + radius] * buffer_d[src];
         }
+        dst[i] = (oT)std::clamp(sum, lo, hi);
       }
     }
   }
@@ -96,7 +113,10 @@ class LOGFilter
 
   float sigma;
   int kernel_size;
-  std::vector<float> kernel;
+  std::vector<float> kernel_g;
+  std::vector<float> kernel_d;
+  std::vector<float> buffer_g;
+  std::vector<float> buffer_d;
   
   const int radius;
   const int width;
@@ -0,0 +1,261 @@
+/**
+ * @file morphology_filter.hpp
+ * @author Ranjodh Singh
+ *
+ * @brief MORPHOLOGY_FILTER. (van Herk / Gil-Werman)
+ *
+ * Copyright (c) 2026 Ranjodh Singh
+ * This file is licensed under the MIT License.
+ * You may obtain a copy of the License at https://opensource.org/license/MIT.
+ */
+#ifndef MORPHOLOGY_FILTER_HPP
+#define MORPHOLOGY_FILTER_HPP
+
+#include <limits>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+
+namespace spotlight {
+
+/**
+ * Square (2r+1) erosion / dilation in ~3 min/max per pixel per pass,
+ * independent of the radius.
+ *
+ * Each line is padded with the identity and cut into segments of length
+ * k = 2r+1. With g the running op from each segment start and h the running
+ * op from each segment end, the window [x-r, x+r] is op(h[x], g[x+2r]) in
+ * padded coordinates. The vertical pass runs the same recurrences on whole
+ * rows, so every step is an elementwise SIMD min/max over a row.
+ */
+class MorphologyFilter
+{
+ public:
+  MorphologyFilter(
+    const int radius,
+    const int width,
+    const int height,
+    const int channels
+  )
+    : radius(radius), width(width), height(height), channels(channels)
+  {
+    kernel_size = 2 * radius + 1;
+    stride = width * channels;
+
+    pad_w = pad(width);
+    pad_h = pad(height);
+
+    line_g.resize(pad_w);
+    line_h.resize(pad_w);
+    tmp.resize(height * stride);
+    rows_g.resize(pad_h * stride);
+    rows_h.resize(pad_h * stride);
+    ident.resize(stride);
+  }
+
+  template <typename T>
+  void erode(const T* inp, T* out)
+  {
+    apply<false>(inp, out);
+  }
+
+  template <typename T>
+  void dilate(const T* inp, T* out)
+  {
+    apply<true>(inp, out);
+  }
+
+  template <typename T>
+  void open(const T* inp, T* out)
+  {
+    apply<false>(inp, out);
+    apply<true>(out, out);
+  }
+
+  template <typename T>
+  void close(const T* inp, T* out)
+  {
+    apply<true>(inp, out);
+    apply<false>(out, out);
+  }
+
+  /* inp and out may alias. */
+  template <bool MAX, typename T>
+  void apply(const T* inp, T* out)
+  {
+    static_assert(
+      std::is_same_v<T, float> || std::is_same_v<T, uint8_t>,
+      "MorphologyFilter supports float and uint8_t only"
+    );
+
+    if (radius <= 0)
+    {
+      if (inp != out)
+        std::copy(inp, inp + height * stride, out);
+      return;
+    }
+
+    T* t = buffer<T>(tmp);
+    T* g = buffer<T>(line_g);
+    T* h = buffer<T>(line_h);
+    const T id = identity<MAX, T>();
+
+    // Horizontal pass (inp -> tmp)
+    for (int y = 0; y < height; y++)
+    {
+      const T* src = inp + y * stride;
+      T* dst = t + y * stride;
+      for (int c = 0; c < channels; c++)
+      {
+        auto at = [&](int p) {
+          const int x = p - radius;
+          return (x < 0 || x >= width) ? id : src[x * channels + c];
+        };
+
+        // pad_w is whole segments
+        for (int s = 0; s < pad_w; s += kernel_size)
+        {
+          const int e = s + kernel_size - 1;
+          g[s] = at(s);
+          for (int p = s + 1; p <= e; p++)
+            g[p] = op<MAX>(g[p - 1], at(p));
+
+          h[e] = at(e);
+          for (int p = e - 1; p >= s; p--)
+            h[p] = op<MAX>(h[p + 1], at(p));
+        }
+
+        for (int x = 0; x < width; x++)
+          dst[x * channels + c] = op<MAX>(h[x], g[x + 2 * radius]);
+      }
+    }
+
+    // Vertical pass (tmp -> out), whole rows at a time
+    T* rg = buffer<T>(rows_g);
+    T* rh = buffer<T>(rows_h);
+    T* rid = buffer<T>(ident);
+    std::fill(rid, rid + stride, id);
+    auto row = [&](int p) -> const T* {
+      const int y = p - radius;
+      return (y < 0 || y >= height) ? rid : t + y * stride;
+    };
+
+    for (int p = 0; p < pad_h; p++)
+    {
+      if (p % kernel_size == 0)
+        std::copy(row(p), row(p) + stride, rg + p * stride);
+      else
+        opRow<MAX>(rg + (p - 1) * stride, row(p), rg + p * stride, stride);
+    }
+
+    std::copy(
+      row(pad_h - 1), row(pad_h - 1) + stride, rh + (pad_h - 1) * stride
+    );
+    for (int p = pad_h - 2; p >= 0; p--)
+    {
+      if (p % kernel_size == kernel_size - 1)
+        std::copy(row(p), row(p) + stride, rh + p * stride);
+      else
+        opRow<MAX>(rh + (p + 1) * stride, row(p), rh + p * stride, stride);
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+      opRow<MAX>(
+        rh + y * stride, rg + (y + 2 * radius) * stride,
+        out + y * stride, stride
+      );
+    }
+  }
+
+  /* Padded length: n + 2r rounded up to a multiple of the kernel size. */
+  inline int pad(const int n) const
+  {
+    const int len = n + 2 * radius;
+    return (len + kernel_size - 1) / kernel_size * kernel_size;
+  }
+
+  template <bool MAX, typename T>
+  static inline T identity()
+  {
+    return MAX ? std::numeric_limits<T>::lowest()
+               : std::numeric_limits<T>::max();
+  }
+
+  template <bool MAX, typename T>
+  static inline T op(const T a, const T b)
+  {
+    return MAX ? std::max(a, b) : std::min(a, b);
+  }
+
+  template <bool MAX>
+  static void opRow(const float* a, const float* b, float* dst, const int n)
+  {
+    int i = 0;
+#ifdef __AVX2__
+    for (; i + 8 <= n; i += 8)
+    {
+      const __m256 va = _mm256_loadu_ps(a + i);
+      const __m256 vb = _mm256_loadu_ps(b + i);
+      _mm256_storeu_ps(
+        dst + i, MAX ? _mm256_max_ps(va, vb) : _mm256_min_ps(va, vb)
+      );
+    }
+#endif
+    for (; i < n; i++)
+      dst[i] = op<MAX>(a[i], b[i]);
+  }
+
+  template <bool MAX>
+  static void opRow(const uint8_t* a, const uint8_t* b, uint8_t* dst, const int n)
+  {
+    int i = 0;
+#ifdef __AVX2__
+    for (; i + 32 <= n; i += 32)
+    {
+      const __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+      const __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+      _mm256_storeu_si256(
+        (__m256i*)(dst + i),
+        MAX ? _mm256_max_epu8(va, vb) : _mm256_min_epu8(va, vb)
+      );
+    }
+#endif
+    for (; i < n; i++)
+      dst[i] = op<MAX>(a[i], b[i]);
+  }
+
+  /* Scratch is kept as float and reused for uint8_t masks. */
+  template <typename T>
+  inline T* buffer(std::vector<float>& vec)
+  {
+    return reinterpret_cast<T*>(vec.data());
+  }
+
+
+  int stride;
+  int pad_w;
+  int pad_h;
+  int kernel_size;
+  std::vector<float> tmp;
+  std::vector<float> line_g;
+  std::vector<float> line_h;
+  std::vector<float> rows_g;
+  std::vector<float> rows_h;
+  std::vector<float> ident;
+
+  const int radius;
+  const int width;
+  const int height;
+  const int channels;
+};
+
+} // namespace spotlight
+
+#endif // MORPHOLOGY_FILTER_HPP
@@ -0,0 +1,258 @@
+/**
+ * @file motion_filter.hpp
+ * @author Ranjodh Singh
+ *
+ * @brief MOTION_FILTER. (block matching motion compensation)
+ *
+ * Copyright (c) 2026 Ranjodh Singh
+ * This file is licensed under the MIT License.
+ * You may obtain a copy of the License at https://opensource.org/license/MIT.
+ */
+#ifndef MOTION_FILTER_HPP
+#define MOTION_FILTER_HPP
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+
+namespace spotlight {
+
+/**
+ * Carries a mask from the previous frame to the current one.
+ *
+ * The current luma is cut into block x block tiles and each tile is matched
+ * (full search, +-radius pixels, SAD) against the previous luma, giving a
+ * backward vector per tile: cur(p) ~ prev(p + v). Vectors are bilinearly
+ * interpolated between tile centers and the mask is resampled along them,
+ * so there are no block edges in the warped mask.
+ *
+ * Each candidate costs SAD + LAMBDA * (|dx| + |dy|), which keeps flat and
+ * noisy tiles at zero motion.
+ */
+class MotionFilter
+{
+ public:
+  MotionFilter(
+    const int radius,
+    const int block,
+    const int width,
+    const int height
+  )
+    : radius(radius), block(block), width(width), height(height)
+  {
+    blocks_x = std::max(1, (width + block - 1) / block);
+    blocks_y = std::max(1, (height + block - 1) / block);
+
+    vec_x.resize(blocks_x * blocks_y);
+    vec_y.resize(blocks_x * blocks_y);
+    warped.resize(height * width);
+  }
+
+  /**
+   * prev / cur: luma of the previous and current frame, width x height.
+   * inp: mask of the previous frame, out: mask moved to the current frame.
+   * inp and out may alias.
+   */
+  template <typename T>
+  void invoke(
+    const uint8_t* prev,
+    const uint8_t* cur,
+    const T* inp,
+    T* out
+  )
+  {
+    estimate(prev, cur);
+    warp(inp, warped.data());
+    for (int i = 0; i < height * width; i++)
+      out[i] = (T)warped[i];
+  }
+
+  void estimate(const uint8_t* prev, const uint8_t* cur)
+  {
+    for (int by = 0; by < blocks_y; by++)
+    {
+      for (int bx = 0; bx < blocks_x; bx++)
+      {
+        // Last row / column of tiles is pulled inside the frame
+        const int x = std::max(0, std::min(bx * block, width - block));
+        const int y = std::max(0, std::min(by * block, height - block));
+        const int bw = std::min(block, width);
+        const int bh = std::min(block, height);
+
+        const int dx0 = -std::min(radius, x);
+        const int dy0 = -std::min(radius, y);
+        const int dx1 = std::min(radius, width - bw - x);
+        const int dy1 = std::min(radius, height - bh - y);
+
+        const uint8_t* c = cur + y * width + x;
+        int best = sad(c, prev + y * width + x, bw, bh);
+        int best_dx = 0, best_dy = 0;
+        for (int dy = dy0; dy <= dy1; dy++)
+        {
+          for (int dx = dx0; dx <= dx1; dx++)
+          {
+            const int penalty = LAMBDA * (std::abs(dx) + std::abs(dy));
+            if (penalty >= best)
+              continue;
+            const int cost = penalty + sad(
+              c, prev + (y + dy) * width + (x + dx), bw, bh
+            );
+            if (cost < best)
+            {
+              best = cost;
+              best_dx = dx;
+              best_dy = dy;
+            }
+          }
+        }
+
+        vec_x[by * blocks_x + bx] = (float)best_dx;
+        vec_y[by * blocks_x + bx] = (float)best_dy;
+      }
+    }
+  }
+
+  /* out(p) = inp(p + v(p)), v interpolated between tile centers. */
+  template <typename iT, typename oT>
+  void warp(const iT* inp, oT* out) const
+  {
+    const float half = 0.5f * block - 0.5f;
+    for (int y = 0; y < height; y++)
+    {
+      const float ty = std::clamp((y - half) / block, 0.f, blocks_y - 1.f);
+      const int ty0 = (int)ty;
+      const int ty1 = std::min(ty0 + 1, blocks_y - 1);
+      const float fy = ty - ty0;
+
+      for (int x = 0; x < width; x++)
+      {
+        const float tx = std::clamp((x - half) / block, 0.f, blocks_x - 1.f);
+        const int tx0 = (int)tx;
+        const int tx1 = std::min(tx0 + 1, blocks_x - 1);
+        const float fx = tx - tx0;
+
+        const float vx = lerp2(vec_x, tx0, tx1, ty0, ty1, fx, fy);
+        const float vy = lerp2(vec_y, tx0, tx1, ty0, ty1, fx, fy);
+
+        const float sx = std::clamp(x + vx, 0.f, width - 1.f);
+        const float sy = std::clamp(y + vy, 0.f, height - 1.f);
+        const int x0 = (int)sx, x1 = std::min(x0 + 1, width - 1);
+        const int y0 = (int)sy, y1 = std::min(y0 + 1, height - 1);
+        const float ax = sx - x0, ay = sy - y0;
+
+        const float i0 = inp[y0 * width + x0] +
+                         (inp[y0 * width + x1] - inp[y0 * width + x0]) * ax;
+        const float i1 = inp[y1 * width + x0] +
+                         (inp[y1 * width + x1] - inp[y1 * width + x0]) * ax;
+        out[y * width + x] = (oT)(i0 + (i1 - i0) * ay);
+      }
+    }
+  }
+
+  inline float lerp2(
+    const std::vector<float>& v,
+    const int x0, const int x1,
+    const int y0, const int y1,
+    const float fx, const float fy
+  ) const
+  {
+    const float a = v[y0 * blocks_x + x0];
+    const float b = v[y0 * blocks_x + x1];
+    const float c = v[y1 * blocks_x + x0];
+    const float d = v[y1 * blocks_x + x1];
+    const float top = a + (b - a) * fx;
+    const float bot = c + (d - c) * fx;
+    return top + (bot - top) * fy;
+  }
+
+  /* Sum of absolute differences of two bw x bh tiles, both `width` apart. */
+  inline int sad(
+    const uint8_t* a,
+    const uint8_t* b,
+    const int bw,
+    const int bh
+  ) const
+  {
+    int sum = 0;
+    int y = 0;
+#ifdef __AVX2__
+    if (bw == 8)
+    {
+      // 4 rows of 8 per register, psadbw leaves 4 partial sums
+      __m256i acc = _mm256_setzero_si256();
+      for (; y + 4 <= bh; y += 4)
+      {
+        const __m256i va = load4x8(a + y * width);
+        const __m256i vb = load4x8(b + y * width);
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(va, vb));
+      }
+      const __m128i s = _mm_add_epi64(
+        _mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1)
+      );
+      sum = _mm_cvtsi128_si32(s) + _mm_extract_epi32(s, 2);
+    }
+    else if (bw == 16)
+    {
+      __m256i acc = _mm256_setzero_si256();
+      for (; y + 2 <= bh; y += 2)
+      {
+        const __m256i va = _mm256_loadu2_m128i(
+          (const __m128i*)(a + (y + 1) * width), (const __m128i*)(a + y * width)
+        );
+        const __m256i vb = _mm256_loadu2_m128i(
+          (const __m128i*)(b + (y + 1) * width), (const __m128i*)(b + y * width)
+        );
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(va, vb));
+      }
+      const __m128i s = _mm_add_epi64(
+        _mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1)
+      );
+      sum = _mm_cvtsi128_si32(s) + _mm_extract_epi32(s, 2);
+    }
+#endif
+    for (; y < bh; y++)
+    {
+      const uint8_t* ra = a + y * width;
+      const uint8_t* rb = b + y * width;
+      for (int x = 0; x < bw; x++)
+        sum += std::abs((int)ra[x] - (int)rb[x]);
+    }
+    return sum;
+  }
+
+#ifdef __AVX2__
+  inline __m256i load4x8(const uint8_t* p) const
+  {
+    long long r[4];
+    for (int i = 0; i < 4; i++)
+      std::memcpy(&r[i], p + i * width, 8);
+    return _mm256_setr_epi64x(r[0], r[1], r[2], r[3]);
+  }
+#endif
+
+
+  int blocks_x;
+  int blocks_y;
+  std::vector<float> vec_x;
+  std::vector<float> vec_y;
+  std::vector<float> warped;
+
+  const int radius;
+  const int block;
+  const int width;
+  const int height;
+
+  static constexpr int LAMBDA = 4;
+};
+
+} // namespace spotlight
+
+#endif // MOTION_FILTER_HPP
@@ -14,15 +14,76 @@
 #include <cstdint>
 #include <stddef.h>
 
+#include <spotlight/utils/roi_utils.hpp>
+#include <spotlight/utils/error_utils.hpp>
+#include <spotlight/formats/yuv_frame.hpp>
+
 
 namespace spotlight {
 
+/* A width x height RGB24 image to decode a whole frame into. */
+struct ScaledTarget
+{
+  uint8_t* rgb;
+  int width;
+  int height;
+};
+
 class Converter
 {
  public:
   virtual ~Converter() = default;
   virtual void decode(const uint8_t* src, uint8_t* dest, size_t size) = 0;
   virtual void encode(const uint8_t* src, uint8_t* dest, size_t* size) = 0;
+
+  /**
+   * Decodes at least `region` of the frame into its place in `dest` (same
+   * layout as decode), other pixels are left as they were.
+   */
+  virtual void decodeRegion(
+    const uint8_t* src, uint8_t* dest, size_t size, const Rect& /* region */
+  )
+  {
+    decode(src, dest, size);
+  }
+
+  /* Whether decodeScaled can ever succeed. */
+  virtual bool ScaledDecode() const { return false; }
+
+  /**
+   * The whole frame decoded straight at the target's size, for formats
+   * that can scale while decoding. Returns false, writing nothing, when
+   * that exact size can not be made. Safe to run on another thread next
+   * to any of the other decodes of the same frame.
+   */
+  virtual bool decodeScaled(
+    const uint8_t* /* src */, size_t /* size */, const ScaledTarget& /* dest */
+  )
+  {
+    return false;
+  }
+
+  /* Whether the format is YUV underneath, see decodeYUV / encodeYUV. */
+  virtual bool NativeYUV() const { return false; }
+
+  /**
+   * Decodes into planes in the format's own chroma layout (no colour
+   * conversion), (re)allocating `dest` as needed.
+   */
+  virtual void decodeYUV(
+    const uint8_t* /* src */, YUVFrame& /* dest */, size_t /* size */
+  )
+  {
+    throw_err("No YUV path for this format!!!");
+  }
+
+  /* Encodes planes of any chroma layout. */
+  virtual void encodeYUV(
+    const YUVFrame& /* src */, uint8_t* /* dest */, size_t* /* size */
+  )
+  {
+    throw_err("No YUV path for this format!!!");
+  }
 };
 
 } // namespace spotlight
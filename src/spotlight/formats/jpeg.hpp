@@ -12,10 +12,12 @@
 #define JPEG_HPP
 
 #include <cstring>
+#include <algorithm>
 #include <turbojpeg.h>
 
 #include <spotlight/utils/error_utils.hpp>
 #include <spotlight/formats/converter.hpp>
+#include <spotlight/formats/jpeg_slices.hpp>
 
 
 namespace spotlight {
@@ -23,20 +25,29 @@ namespace spotlight {
 class ConverterJPEG final : public Converter
 {
 public:
-  ConverterJPEG(int width, int height, int quality)
+  /* threads > 1: frames are coded in that many slices (see JPEGSlices). */
+  ConverterJPEG(int width, int height, int quality, int threads = 1)
     : width(width),
       height(height),
       quality(quality),
       rgb_stride(3 * width)
   {
+    if (threads > 1)
+      slices = std::make_unique<JPEGSlices>(width, height, threads);
+
     compress_handle = tjInitCompress();
     if (!compress_handle)
       throw_err("tjInitCompress failed!");
 
     decompress_handle = tjInitDecompress();
-    if (!decompress_handle)
+    scaled_handle = tjInitDecompress();
+    if (!decompress_handle || !scaled_handle)
     {
       tjDestroy(compress_handle);
+      if (decompress_handle)
+        tjDestroy(decompress_handle);
+      if (scaled_handle)
+        tjDestroy(scaled_handle);
       throw_err("tjInitDecompress failed!");
     }
   }
@@ -49,6 +60,8 @@ public:
       tjDestroy(compress_handle);
     if (decompress_handle)
       tjDestroy(decompress_handle);
+    if (scaled_handle)
+      tjDestroy(scaled_handle);
   }
 
   void decode(const uint8_t* jpeg, uint8_t* rgb, size_t size) override
@@ -69,6 +82,34 @@ public:
     )
       throw_err(tjGetErrorStr2(decompress_handle));
 
+    // Slices: vertical chroma upsampling can not look across their edges.
+    // The whole frame path upsamples the same way, so a frame decodes to
+    // the same image whether it is sliced or not.
+    const bool vsub = jpeg_subsamp == TJSAMP_420 || jpeg_subsamp == TJSAMP_440;
+    const int flags = TJFLAG_FASTDCT | (vsub ? TJFLAG_FASTUPSAMPLE : 0);
+    if (
+      slices &&
+      slices->decode(jpeg, size, [&](
+        tjhandle handle, const uint8_t* sub, size_t sub_size, int y0, int rows
+      ) {
+        if (
+          tjDecompress2(
+            handle,
+            sub,
+            sub_size,
+            rgb + (size_t)y0 * rgb_stride,
+            width,
+            rgb_stride,
+            rows,
+            TJPF_RGB,
+            flags
+          ) != 0
+        )
+          throw_err(tjGetErrorStr2(handle));
+      })
+    )
+      return;
+
     if (
       tjDecompress2(
         decompress_handle,
@@ -79,10 +120,245 @@ public:
         rgb_stride,
         height,
         TJPF_RGB,
+        flags
+      ) != 0
+    )
+      throw_err(tjGetErrorStr2(decompress_handle));
+  }
+
+  /**
+   * libjpeg-turbo 3 crops while decompressing: rows above the region are
+   * only entropy decoded, rows below are not read and columns outside it
+   * skip IDCT and color conversion. The left edge is aligned down to an
+   * MCU. Older libraries decode the whole frame.
+   */
+  void decodeRegion(
+    const uint8_t* jpeg, uint8_t* rgb, size_t size, const Rect& region
+  ) override
+  {
+#ifdef TJ_NUMINIT
+    if (tj3DecompressHeader(decompress_handle, jpeg, size) != 0)
+      throw_err(tj3GetErrorStr(decompress_handle));
+
+    const int subsamp = tj3Get(decompress_handle, TJPARAM_SUBSAMP);
+    const int mcu_w = (subsamp >= 0) ? tjMCUWidth[subsamp] : 8;
+    const int x = region.x / mcu_w * mcu_w;
+    const tjregion crop = {x, region.y, region.x + region.w - x, region.h};
+
+    tj3Set(decompress_handle, TJPARAM_FASTDCT, 1);
+    if (tj3SetCroppingRegion(decompress_handle, crop) != 0)
+      throw_err(tj3GetErrorStr(decompress_handle));
+
+    const int ret = tj3Decompress8(
+      decompress_handle,
+      jpeg,
+      size,
+      rgb + (region.y * width + x) * 3,
+      rgb_stride,
+      TJPF_RGB
+    );
+    tj3SetCroppingRegion(decompress_handle, TJUNCROPPED);
+    if (ret != 0)
+      throw_err(tj3GetErrorStr(decompress_handle));
+#else
+    (void)region;
+    decode(jpeg, rgb, size);
+#endif
+  }
+
+  bool ScaledDecode() const override { return true; }
+
+  /**
+   * libjpeg-turbo scales by 1/2, 1/4 and 1/8 inside the inverse DCT, so
+   * those sizes cost a fraction of a full decode plus entropy decoding.
+   * Has its own handle: runs next to decode / decodeYUV.
+   */
+  bool decodeScaled(
+    const uint8_t* jpeg, size_t size, const ScaledTarget& dest
+  ) override
+  {
+    int n = 0;
+    const tjscalingfactor* factors = tjGetScalingFactors(&n);
+    bool found = false;
+    for (int i = 0; i < n && !found; i++)
+    {
+      found = (
+        factors[i].num < factors[i].denom &&
+        TJSCALED(width, factors[i]) == dest.width &&
+        TJSCALED(height, factors[i]) == dest.height
+      );
+    }
+    if (!found)
+      return false;
+
+    if (
+      tjDecompress2(
+        scaled_handle,
+        jpeg,
+        size,
+        dest.rgb,
+        dest.width,
+        3 * dest.width,
+        dest.height,
+        TJPF_RGB,
         TJFLAG_FASTDCT
       ) != 0
+    )
+      throw_err(tjGetErrorStr2(scaled_handle));
+    return true;
+  }
+
+  bool NativeYUV() const override { return true; }
+
+  /**
+   * The planes as coded, in the frame's own subsampling: libjpeg-turbo
+   * skips chroma upsampling and the YCbCr -> RGB conversion. Grayscale
+   * frames get neutral 4:2:0 chroma.
+   */
+  void decodeYUV(const uint8_t* jpeg, YUVFrame& dest, size_t size) override
+  {
+    int jpeg_width = 0, jpeg_height = 0;
+    int jpeg_subsamp = 0, jpeg_colorspace = 0;
+
+    if (
+      tjDecompressHeader3(
+        decompress_handle,
+        jpeg,
+        size,
+        &jpeg_width,
+        &jpeg_height,
+        &jpeg_subsamp,
+        &jpeg_colorspace
+      ) != 0
     )
       throw_err(tjGetErrorStr2(decompress_handle));
+
+    if (jpeg_width != width || jpeg_height != height)
+      throw_err("JPEG frame size differs from the device!!!");
+    if (jpeg_colorspace != TJCS_YCbCr && jpeg_colorspace != TJCS_GRAY)
+      throw_err("JPEG frame is not YCbCr!!!");
+
+    const bool gray = jpeg_subsamp == TJSAMP_GRAY;
+    const int subsamp = gray ? TJSAMP_420 : jpeg_subsamp;
+    const int cw = tjPlaneWidth(1, width, subsamp);
+    const int ch = tjPlaneHeight(1, height, subsamp);
+    dest.alloc(width, height, cw, ch);
+    dest.full_range = true;
+
+    if (
+      slices &&
+      slices->decode(jpeg, size, [&](
+        tjhandle handle, const uint8_t* sub, size_t sub_size, int y0, int rows
+      ) {
+        const size_t cy0 = tjPlaneHeight(1, y0, subsamp);
+        unsigned char* planes[3] = {
+          dest.y.data() + (size_t)y0 * width,
+          dest.u.data() + cy0 * cw,
+          dest.v.data() + cy0 * cw
+        };
+        int strides[3] = {width, cw, cw};
+        if (
+          tjDecompressToYUVPlanes(
+            handle, sub, sub_size, planes, width, strides, rows,
+            TJFLAG_FASTDCT
+          ) != 0
+        )
+          throw_err(tjGetErrorStr2(handle));
+      })
+    )
+    {
+      neutral(dest, gray);
+      return;
+    }
+
+    unsigned char* planes[3] = {dest.y.data(), dest.u.data(), dest.v.data()};
+    int strides[3] = {width, cw, cw};
+    if (
+      tjDecompressToYUVPlanes(
+        decompress_handle,
+        jpeg,
+        size,
+        planes,
+        width,
+        strides,
+        height,
+        TJFLAG_FASTDCT
+      ) != 0
+    )
+      throw_err(tjGetErrorStr2(decompress_handle));
+    neutral(dest, gray);
+  }
+
+  /**
+   * Encoded in the planes' own subsampling (any libjpeg-turbo has).
+   * JPEG is full range: limited range planes are stretched first.
+   */
+  void encodeYUV(const YUVFrame& frame, uint8_t* jpeg, size_t* size) override
+  {
+    if (frame.width != width || frame.height != height)
+      throw_err("YUVFrame size differs from the device!!!");
+    if (!frame.full_range)
+      convert_range(frame, range_buf, true);
+    const YUVFrame& src = frame.full_range ? frame : range_buf;
+
+    int subsamp = -1;
+    for (const int s : {TJSAMP_444, TJSAMP_422, TJSAMP_420, TJSAMP_440, TJSAMP_411})
+    {
+      if (
+        tjPlaneWidth(1, width, s) == src.chroma_w &&
+        tjPlaneHeight(1, height, s) == src.chroma_h
+      )
+        subsamp = s;
+    }
+    if (subsamp < 0)
+      throw_err("YUVFrame chroma layout has no JPEG subsampling!!!");
+
+    const int strides[3] = {width, src.chroma_w, src.chroma_w};
+    if (slices)
+    {
+      slices->encode(
+        tjMCUWidth[subsamp], tjMCUHeight[subsamp],
+        [&](
+          tjhandle handle, int y0, int rows,
+          unsigned char** buf, unsigned long* buf_size
+        ) {
+          const size_t cy0 = tjPlaneHeight(1, y0, subsamp);
+          const unsigned char* planes[3] = {
+            src.y.data() + (size_t)y0 * width,
+            src.u.data() + cy0 * src.chroma_w,
+            src.v.data() + cy0 * src.chroma_w
+          };
+          if (
+            tjCompressFromYUVPlanes(
+              handle, planes, width, strides, rows, subsamp,
+              buf, buf_size, quality, TJFLAG_FASTDCT
+            ) != 0
+          )
+            throw_err(tjGetErrorStr2(handle));
+        },
+        jpeg, size
+      );
+      return;
+    }
+
+    const unsigned char* planes[3] = {src.y.data(), src.u.data(), src.v.data()};
+    if (
+      tjCompressFromYUVPlanes(
+        compress_handle,
+        planes,
+        width,
+        strides,
+        height,
+        subsamp,
+        &jpeg_buf,
+        &jpeg_size,
+        quality,
+        TJFLAG_FASTDCT
+      ) != 0
+    )
+      throw_err(tjGetErrorStr2(compress_handle));
+
+    output(jpeg, size);
   }
 
   void encode(const uint8_t* rgb, uint8_t* jpeg, size_t* size) override
@@ -91,6 +367,27 @@ public:
     const int subsamp = TJSAMP_420;
     const int flags = TJFLAG_FASTDCT | TJFLAG_FASTUPSAMPLE;
 
+    if (slices)
+    {
+      slices->encode(
+        tjMCUWidth[subsamp], tjMCUHeight[subsamp],
+        [&](
+          tjhandle handle, int y0, int rows,
+          unsigned char** buf, unsigned long* buf_size
+        ) {
+          if (
+            tjCompress2(
+              handle, rgb + (size_t)y0 * rgb_stride, width, rgb_stride, rows,
+              format, buf, buf_size, subsamp, quality, flags
+            ) != 0
+          )
+            throw_err(tjGetErrorStr2(handle));
+        },
+        jpeg, size
+      );
+      return;
+    }
+
     if (
       tjCompress2(
         compress_handle,
@@ -108,6 +405,22 @@ public:
     )
       throw_err(tjGetErrorStr2(compress_handle));
 
+    output(jpeg, size);
+  }
+
+private:
+  /* Grayscale frames: the chroma planes to neutral. */
+  static void neutral(YUVFrame& frame, const bool gray)
+  {
+    if (!gray)
+      return;
+    std::fill(frame.u.begin(), frame.u.end(), 128);
+    std::fill(frame.v.begin(), frame.v.end(), 128);
+  }
+
+  /* Copies jpeg_buf out into a `*size` bytes buffer. */
+  void output(uint8_t* jpeg, size_t* size)
+  {
     if (jpeg_size <= *size)
     {
       *size = static_cast<size_t>(jpeg_size);
@@ -119,13 +432,17 @@ public:
     }
   }
 
-private:
   tjhandle compress_handle = nullptr;
   tjhandle decompress_handle = nullptr;
+  tjhandle scaled_handle = nullptr;
+  std::unique_ptr<JPEGSlices> slices;
 
   unsigned char* jpeg_buf = nullptr;
   unsigned long jpeg_size = 0;
 
+  // encodeYUV: limited range planes in full range
+  YUVFrame range_buf;
+
   const int width;
   const int height;
   const int quality;
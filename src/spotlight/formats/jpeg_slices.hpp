@@ -0,0 +1,370 @@
+/**
+ * @file jpeg_slices.hpp
+ * @author Ranjodh Singh
+ *
+ * @brief JPEG_SLICES.
+ *
+ * Copyright (c) 2026 Ranjodh Singh
+ * This file is licensed under the MIT License.
+ * You may obtain a copy of the License at https://opensource.org/license/MIT.
+ */
+#ifndef JPEG_SLICES_HPP
+#define JPEG_SLICES_HPP
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <exception>
+#include <turbojpeg.h>
+
+#include <spotlight/utils/worker.hpp>
+#include <spotlight/utils/error_utils.hpp>
+
+
+namespace spotlight {
+
+/**
+ * Baseline JPEG split into horizontal slices that are coded in parallel,
+ * one tjhandle and thread per slice (the caller's thread is slice 0).
+ *
+ * Encode: every slice (whole MCU rows) is compressed on its own, with the
+ * same quality, subsampling and standard Huffman tables, and the pieces
+ * are joined into one image: the first piece's headers with the full
+ * height, a DRI of one slice worth of MCUs and every piece's entropy coded
+ * data, RSTn in between. A restart resets DC prediction exactly like the
+ * start of a fresh image, so the result is an ordinary restart coded JPEG.
+ *
+ * Decode: a frame whose restart interval (DRI) is whole MCU rows is cut on
+ * its RST markers into sub-images of whole intervals, headers patched to
+ * their height and markers renumbered, which decode in parallel into their
+ * rows. Other frames are left to the caller.
+ */
+class JPEGSlices
+{
+ public:
+  JPEGSlices(const int width, const int height, const int n_slices)
+    : width(width), height(height), n_slices(std::max(1, n_slices))
+  {
+    for (int i = 0; i < this->n_slices; i++)
+    {
+      slices.push_back(std::make_unique<Slice>());
+      Slice& s = *slices.back();
+      s.compress = tjInitCompress();
+      s.decompress = tjInitDecompress();
+      if (!s.compress || !s.decompress)
+        throw_err("tjInit failed!");
+      if (i > 0)
+        s.worker = std::make_unique<Worker>();
+    }
+  }
+
+  /* Frame rows per slice for an MCU mcu_h rows high, all but the last. */
+  int SliceRows(const int mcu_h) const
+  {
+    const int mcu_rows = (height + mcu_h - 1) / mcu_h;
+    return (mcu_rows + n_slices - 1) / n_slices * mcu_h;
+  }
+
+  /**
+   * The frame into `*size` bytes at jpeg, MCUs mcu_w x mcu_h.
+   * compress(handle, y0, rows, &buf, &size): rows [y0, y0 + rows) of the
+   * frame as a JPEG into buf (TurboJPEG allocated, may be reallocated).
+   */
+  template <typename Fn>
+  void encode(
+    const int mcu_w,
+    const int mcu_h,
+    Fn&& compress,
+    uint8_t* jpeg,
+    size_t* size
+  )
+  {
+    const int rows = SliceRows(mcu_h);
+    const int n = (height + rows - 1) / rows;
+    const int interval = (width + mcu_w - 1) / mcu_w * (rows / mcu_h);
+    if (interval > 0xFFFF)
+      throw_err("JPEG slice too large for a restart interval!!!");
+
+    parallel(n, [&](const int i) {
+      Slice& s = *slices[i];
+      const int y0 = i * rows;
+      // s.size is the last piece's size, which the buffer still holds
+      compress(s.compress, y0, std::min(rows, height - y0), &s.buf, &s.size);
+    });
+
+    // Headers of piece 0 up to and with its SOS, height patched, + DRI
+    const uint8_t dri[6] = {
+      0xFF, 0xDD, 0x00, 0x04,
+      (uint8_t)(interval >> 8), (uint8_t)(interval & 0xFF)
+    };
+    Markers m;
+    if (!parse(slices[0]->buf, slices[0]->size, m) || m.dri >= 0)
+      throw_err("Unexpected JPEG from tjCompress!!!");
+
+    // Every piece's headers but the first are dropped: an upper bound
+    size_t total = sizeof(dri);
+    for (int i = 0; i < n; i++)
+      total += slices[i]->size;
+    if (total > *size)
+      throw_err("JPEG does not fit the output buffer!!!");
+
+    uint8_t* out = put(jpeg, slices[0]->buf, m.sos);
+    jpeg[m.sof + 5] = (uint8_t)(height >> 8);
+    jpeg[m.sof + 6] = (uint8_t)(height & 0xFF);
+    out = put(out, dri, sizeof(dri));
+    out = put(out, slices[0]->buf + m.sos, m.data - m.sos);
+
+    for (int i = 0; i < n; i++)
+    {
+      Slice& s = *slices[i];
+      Markers p;
+      if (i > 0 && !parse(s.buf, s.size, p))
+        throw_err("Unexpected JPEG from tjCompress!!!");
+      const size_t begin = i > 0 ? p.data : m.data;
+      if (
+        s.size < begin + 2 ||
+        s.buf[s.size - 2] != 0xFF || s.buf[s.size - 1] != 0xD9
+      )
+        throw_err("Unexpected JPEG from tjCompress!!!");
+
+      out = put(out, s.buf + begin, s.size - 2 - begin);
+      const uint8_t marker[2] = {
+        0xFF, (uint8_t)(i + 1 < n ? 0xD0 + i % 8 : 0xD9)
+      };
+      out = put(out, marker, 2);
+    }
+    *size = out - jpeg;
+  }
+
+  /**
+   * decompress(handle, jpeg, size, y0, rows): a JPEG of rows
+   * [y0, y0 + rows) of the frame into its place. Returns false, decoding
+   * nothing, when the frame has no restarts on MCU row boundaries (or is
+   * not baseline).
+   */
+  template <typename Fn>
+  bool decode(const uint8_t* jpeg, const size_t size, Fn&& decompress)
+  {
+    Markers m;
+    if (!parse(jpeg, size, m) || m.dri <= 0 || !m.baseline)
+      return false;
+    if (m.width != width || m.height != height)
+      return false;
+
+    const int mcu_w = 8 * m.max_h;
+    const int mcu_h = 8 * m.max_v;
+    const int per_row = (width + mcu_w - 1) / mcu_w;
+    if (m.dri % per_row != 0)
+      return false;
+
+    // Entropy coded segments between RST markers
+    const int interval_rows = m.dri / per_row * mcu_h;
+    const int intervals = (height + interval_rows - 1) / interval_rows;
+    if (intervals < 2)
+      return false;
+
+    segments.clear();
+    size_t start = m.data;
+    size_t end = size;
+    for (size_t i = m.data; i + 1 < size; i++)
+    {
+      if (jpeg[i] != 0xFF)
+        continue;
+      const uint8_t c = jpeg[i + 1];
+      if (c >= 0xD0 && c <= 0xD7)
+      {
+        segments.push_back({start, i});
+        start = i + 2;
+        i++;
+      }
+      else if (c == 0xD9)
+      {
+        end = i;
+        break;
+      }
+      else if (c == 0x00 || c == 0xFF)
+      {
+        i += c == 0x00;
+      }
+      else
+      {
+        return false;
+      }
+    }
+    segments.push_back({start, end});
+    if ((int)segments.size() != intervals)
+      return false;
+
+    const int n = std::min(n_slices, intervals);
+    parallel(n, [&](const int k) {
+      Slice& s = *slices[k];
+      const int first = k * intervals / n;
+      const int last = (k + 1) * intervals / n;
+      const int y0 = first * interval_rows;
+      const int rows = std::min(last * interval_rows, height) - y0;
+
+      s.sub.clear();
+      s.sub.insert(s.sub.end(), jpeg, jpeg + m.data);
+      s.sub[m.sof + 5] = (uint8_t)(rows >> 8);
+      s.sub[m.sof + 6] = (uint8_t)(rows & 0xFF);
+      for (int j = first; j < last; j++)
+      {
+        const Segment& seg = segments[j];
+        s.sub.insert(s.sub.end(), jpeg + seg.begin, jpeg + seg.end);
+        s.sub.push_back(0xFF);
+        s.sub.push_back(
+          (uint8_t)(j + 1 < last ? 0xD0 + (j - first) % 8 : 0xD9)
+        );
+      }
+      decompress(s.decompress, s.sub.data(), s.sub.size(), y0, rows);
+    });
+    return true;
+  }
+
+ private:
+  /* Offsets of the markers that matter, 0 / -1 when absent. */
+  struct Markers
+  {
+    size_t sof = 0;
+    size_t sos = 0;
+    size_t data = 0;
+    int dri = -1;
+    bool baseline = false;
+    int width = 0;
+    int height = 0;
+    int max_h = 1;
+    int max_v = 1;
+  };
+
+  struct Segment
+  {
+    size_t begin;
+    size_t end;
+  };
+
+  /* Handles and buffers of one slice, the worker stops first. */
+  struct Slice
+  {
+    ~Slice()
+    {
+      worker.reset();
+      if (buf)
+        tjFree(buf);
+      if (compress)
+        tjDestroy(compress);
+      if (decompress)
+        tjDestroy(decompress);
+    }
+
+    tjhandle compress = nullptr;
+    tjhandle decompress = nullptr;
+    unsigned char* buf = nullptr;
+    unsigned long size = 0;
+    std::vector<uint8_t> sub;
+    std::unique_ptr<Worker> worker;
+  };
+
+  /* Walks the header segments up to the start of the entropy coded data. */
+  static bool parse(const uint8_t* jpeg, const size_t size, Markers& m)
+  {
+    if (size < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8)
+      return false;
+
+    size_t i = 2;
+    while (i + 4 <= size)
+    {
+      if (jpeg[i] != 0xFF)
+        return false;
+      const uint8_t c = jpeg[i + 1];
+      if (c == 0xFF)
+      {
+        i++;
+        continue;
+      }
+      const size_t len = (jpeg[i + 2] << 8) | jpeg[i + 3];
+      if (i + 2 + len > size)
+        return false;
+
+      if (c == 0xC0 || c == 0xC1)
+      {
+        const uint8_t* p = jpeg + i + 4;
+        m.sof = i;
+        m.baseline = true;
+        m.height = (p[1] << 8) | p[2];
+        m.width = (p[3] << 8) | p[4];
+        for (int k = 0; k < p[5]; k++)
+        {
+          m.max_h = std::max(m.max_h, p[7 + 3 * k] >> 4);
+          m.max_v = std::max(m.max_v, p[7 + 3 * k] & 0x0F);
+        }
+      }
+      else if (c >= 0xC2 && c <= 0xCF && c != 0xC4 && c != 0xC8 && c != 0xCC)
+      {
+        m.sof = i;
+        m.baseline = false;
+      }
+      else if (c == 0xDD)
+      {
+        m.dri = (jpeg[i + 4] << 8) | jpeg[i + 5];
+      }
+      else if (c == 0xDA)
+      {
+        m.sos = i;
+        m.data = i + 2 + len;
+        return m.sof > 0;
+      }
+      i += 2 + len;
+    }
+    return false;
+  }
+
+  static uint8_t* put(uint8_t* out, const uint8_t* src, const size_t n)
+  {
+    std::memcpy(out, src, n);
+    return out + n;
+  }
+
+  /* fn(0 .. n - 1), slice 0 on this thread; rethrows the first error. */
+  template <typename Fn>
+  void parallel(const int n, Fn&& fn)
+  {
+    for (int i = 1; i < n; i++)
+      slices[i]->worker->submit([&fn, i] { fn(i); });
+
+    std::exception_ptr error;
+    try
+    {
+      fn(0);
+    }
+    catch (...)
+    {
+      error = std::current_exception();
+    }
+    for (int i = 1; i < n; i++)
+    {
+      try
+      {
+        slices[i]->worker->wait();
+      }
+      catch (...)
+      {
+        if (!error)
+          error = std::current_exception();
+      }
+    }
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  const int width;
+  const int height;
+  const int n_slices;
+  std::vector<std::unique_ptr<Slice>> slices;
+  std::vector<Segment> segments;
+};
+
+} // namespace spotlight
+
+#endif // JPEG_SLICES_HPP
@@ -0,0 +1,242 @@
+/**
+ * @file yuv_frame.hpp
+ * @author Ranjodh Singh
+ *
+ * @brief YUV_FRAME.
+ *
+ * Copyright (c) 2026 Ranjodh Singh
+ * This file is licensed under the MIT License.
+ * You may obtain a copy of the License at https://opensource.org/license/MIT.
+ */
+#ifndef YUV_FRAME_HPP
+#define YUV_FRAME_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <libyuv.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include <spotlight/utils/error_utils.hpp>
+
+
+namespace spotlight {
+
+/**
+ * Planar YUV frame, tightly packed. The chroma planes are chroma_w x
+ * chroma_h: half width and full height for 4:2:2 (YUYV), half both ways for
+ * 4:2:0 and full size for 4:4:4; MJPEG frames come in any of those.
+ * Both are BT.601, MJPEG in full range (JFIF: 0 - 255) and YUYV in
+ * limited range (Y 16 - 235, U / V 16 - 240): decodeYUV sets full_range.
+ */
+struct YUVFrame
+{
+  int width = 0;
+  int height = 0;
+  int chroma_w = 0;
+  int chroma_h = 0;
+  bool full_range = false;
+  std::vector<uint8_t> y, u, v;
+
+  /* Resizes the planes, a no-op when the layout is already this one. */
+  void alloc(const int w, const int h, const int cw, const int ch)
+  {
+    if (w == width && h == height && cw == chroma_w && ch == chroma_h)
+      return;
+
+    width = w, height = h;
+    chroma_w = cw, chroma_h = ch;
+    y.resize((size_t)w * h);
+    u.resize((size_t)cw * ch);
+    v.resize((size_t)cw * ch);
+  }
+
+  /* Same planes and range as `other`. */
+  void allocLike(const YUVFrame& other)
+  {
+    alloc(other.width, other.height, other.chroma_w, other.chroma_h);
+    full_range = other.full_range;
+  }
+};
+
+/**
+ * dst[i] = out + (src[i] - in) * f, rounded and saturated, within one
+ * level of exact. f is Q9 (f * 512) and the product is formed the way
+ * _mm256_mulhrs_epi16 does it, so both paths give the same bytes.
+ */
+inline void range_map(
+  const uint8_t* src,
+  uint8_t* dst,
+  const size_t n,
+  const int in,
+  const int out,
+  const int f
+)
+{
+  size_t i = 0;
+#ifdef __AVX2__
+  const __m256i v_in = _mm256_set1_epi16((short)in);
+  const __m256i v_out = _mm256_set1_epi16((short)out);
+  const __m256i v_f = _mm256_set1_epi16((short)f);
+  for (; i + 32 <= n; i += 32)
+  {
+    const __m256i x = _mm256_loadu_si256((const __m256i*)(src + i));
+    __m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(x));
+    __m256i hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(x, 1));
+    lo = _mm256_slli_epi16(_mm256_sub_epi16(lo, v_in), 6);
+    hi = _mm256_slli_epi16(_mm256_sub_epi16(hi, v_in), 6);
+    lo = _mm256_add_epi16(_mm256_mulhrs_epi16(lo, v_f), v_out);
+    hi = _mm256_add_epi16(_mm256_mulhrs_epi16(hi, v_f), v_out);
+    // packus interleaves the 128 bit lanes
+    const __m256i r = _mm256_permute4x64_epi64(
+      _mm256_packus_epi16(lo, hi), 0xD8
+    );
+    _mm256_storeu_si256((__m256i*)(dst + i), r);
+  }
+#endif
+  for (; i < n; i++)
+  {
+    const int d = (src[i] - in) * 64;
+    dst[i] = (uint8_t)std::clamp(((d * f + (1 << 14)) >> 15) + out, 0, 255);
+  }
+}
+
+/**
+ * src into dst in full or limited range. Both ranges are the BT.601
+ * matrix, so this is a scale and offset per plane; a copy when src is
+ * already in that range.
+ */
+inline void convert_range(const YUVFrame& src, YUVFrame& dst, const bool full)
+{
+  dst.allocLike(src);
+  dst.full_range = full;
+  const size_t n = src.y.size();
+  const size_t cn = src.u.size();
+  if (src.full_range == full)
+  {
+    std::memcpy(dst.y.data(), src.y.data(), n);
+    std::memcpy(dst.u.data(), src.u.data(), cn);
+    std::memcpy(dst.v.data(), src.v.data(), cn);
+    return;
+  }
+
+  // 255 / 219, 255 / 224 and back, Q9
+  const int luma_f = full ? 596 : 440;
+  const int chroma_f = full ? 583 : 450;
+  range_map(
+    src.y.data(), dst.y.data(), n, full ? 16 : 0, full ? 0 : 16, luma_f
+  );
+  range_map(src.u.data(), dst.u.data(), cn, 128, 128, chroma_f);
+  range_map(src.v.data(), dst.v.data(), cn, 128, 128, chroma_f);
+}
+
+/**
+ * RGB <-> YUVFrame at any size and chroma layout, through libyuv's ARGB.
+ * RGB is in memory order R, G, B (libyuv's RAW, not its RGB24), like
+ * TurboJPEG's TJPF_RGB, so it matches the scaled JPEG decodes. The
+ * frame's range picks the matrix: libyuv's JPEG one for full range.
+ * Meant for images at analysis resolution, not for whole frames.
+ */
+class YUVResampler
+{
+ public:
+  /* The whole frame scaled to a w x h RGB image. */
+  void toRGB(const YUVFrame& src, uint8_t* rgb, const int w, const int h)
+  {
+    const uint8_t* y = plane(src.y.data(), src.width, src.height, w, h, 0);
+    const uint8_t* u = plane(src.u.data(), src.chroma_w, src.chroma_h, w, h, 1);
+    const uint8_t* v = plane(src.v.data(), src.chroma_w, src.chroma_h, w, h, 2);
+
+    argb.resize((size_t)4 * w * h);
+    if (
+      libyuv::I444ToARGBMatrix(
+        y, w, u, w, v, w, argb.data(), 4 * w,
+        src.full_range ? &libyuv::kYuvJPEGConstants : &libyuv::kYuvI601Constants,
+        w, h
+      ) != 0
+    )
+      throw_err("I444ToARGBMatrix failed!");
+    if (libyuv::ARGBToRAW(argb.data(), 4 * w, rgb, 3 * w, w, h) != 0)
+      throw_err("ARGBToRAW failed!");
+  }
+
+  /**
+   * A dst.width x dst.height RGB image into dst's planes, in dst's range.
+   * libyuv has no 4:4:4 full range encoder, so full range goes through
+   * its J422 and the chroma is resampled from there.
+   */
+  void fromRGB(const uint8_t* rgb, YUVFrame& dst)
+  {
+    const int w = dst.width;
+    const int h = dst.height;
+    const int sw = dst.full_range ? (w + 1) / 2 : w;
+    const bool direct = dst.chroma_w == sw && dst.chroma_h == h;
+
+    argb.resize((size_t)4 * w * h);
+    for (int i = 1; !direct && i < 3; i++)
+      planes[i].resize((size_t)sw * h);
+    uint8_t* u = direct ? dst.u.data() : planes[1].data();
+    uint8_t* v = direct ? dst.v.data() : planes[2].data();
+
+    if (libyuv::RAWToARGB(rgb, 3 * w, argb.data(), 4 * w, w, h) != 0)
+      throw_err("RAWToARGB failed!");
+    if (dst.full_range)
+    {
+      if (
+        libyuv::ARGBToJ422(
+          argb.data(), 4 * w, dst.y.data(), w, u, sw, v, sw, w, h
+        ) != 0
+      )
+        throw_err("ARGBToJ422 failed!");
+    }
+    else if (
+      libyuv::ARGBToI444(
+        argb.data(), 4 * w, dst.y.data(), w, u, w, v, w, w, h
+      ) != 0
+    )
+      throw_err("ARGBToI444 failed!");
+
+    if (direct)
+      return;
+    libyuv::ScalePlane(
+      u, sw, sw, h, dst.u.data(), dst.chroma_w,
+      dst.chroma_w, dst.chroma_h, libyuv::kFilterBox
+    );
+    libyuv::ScalePlane(
+      v, sw, sw, h, dst.v.data(), dst.chroma_w,
+      dst.chroma_w, dst.chroma_h, libyuv::kFilterBox
+    );
+  }
+
+ private:
+  /* src (sw x sh) at w x h, src itself when it already is. */
+  const uint8_t* plane(
+    const uint8_t* src,
+    const int sw,
+    const int sh,
+    const int w,
+    const int h,
+    const int i
+  )
+  {
+    if (sw == w && sh == h)
+      return src;
+
+    planes[i].resize((size_t)w * h);
+    libyuv::ScalePlane(
+      src, sw, sw, sh, planes[i].data(), w, w, h, libyuv::kFilterBox
+    );
+    return planes[i].data();
+  }
+
+  std::vector<uint8_t> argb;
+  std::vector<uint8_t> planes[3];
+};
+
+} // namespace spotlight
+
+#endif // YUV_FRAME_HPP
@@ -35,6 +35,7 @@ public:
     argb_buffer = vec_argb_buffer.data();
   }
 
+  /* RGB in memory order R, G, B (libyuv's RAW), like ConverterJPEG's. */
   void decode(const uint8_t* yuyv, uint8_t* rgb, size_t /* size */) override
   {
     if (
@@ -50,7 +51,7 @@ public:
       throw_err("YUY2ToARGB failed!");
 
     if (
-      libyuv::ARGBToRGB24(
+      libyuv::ARGBToRAW(
         argb_buffer,
         argb_stride,
         rgb,
@@ -59,13 +60,46 @@ public:
         height
       ) != 0
     )
-      throw_err("ARGBToRGB24 failed!");
+      throw_err("ARGBToRAW failed!");
+  }
+
+  /* Converts only the region (left edge aligned to a YUYV pair). */
+  void decodeRegion(
+    const uint8_t* yuyv, uint8_t* rgb, size_t /* size */, const Rect& region
+  ) override
+  {
+    const int x = region.x & ~1;
+    const int w = region.x + region.w - x;
+
+    if (
+      libyuv::YUY2ToARGB(
+        yuyv + region.y * yuyv_stride + 2 * x,
+        yuyv_stride,
+        argb_buffer + region.y * argb_stride + 4 * x,
+        argb_stride,
+        w,
+        region.h
+      ) != 0
+    )
+      throw_err("YUY2ToARGB failed!");
+
+    if (
+      libyuv::ARGBToRAW(
+        argb_buffer + region.y * argb_stride + 4 * x,
+        argb_stride,
+        rgb + region.y * rgb_stride + 3 * x,
+        rgb_stride,
+        w,
+        region.h
+      ) != 0
+    )
+      throw_err("ARGBToRAW failed!");
   }
 
   void encode(const uint8_t* rgb, uint8_t* yuyv, size_t* /* size */) override
   {
     if (
-      libyuv::RGB24ToARGB(
+      libyuv::RAWToARGB(
         rgb,
         rgb_stride,
         argb_buffer,
@@ -74,7 +108,7 @@ public:
         height
       ) != 0
     )
-      throw_err("RGB24ToARGB failed!");
+      throw_err("RAWToARGB failed!");
 
     if (
       libyuv::ARGBToYUY2(
@@ -89,10 +123,86 @@ public:
       throw_err("ARGBToYUY2 failed!");
   }
 
+  bool NativeYUV() const override { return true; }
+
+  /* YUYV is 4:2:2, unpacking it into planes is a shuffle. */
+  void decodeYUV(const uint8_t* yuyv, YUVFrame& dest, size_t /* size */) override
+  {
+    const int cw = (width + 1) / 2;
+    dest.alloc(width, height, cw, height);
+    dest.full_range = false;
+
+    if (
+      libyuv::YUY2ToI422(
+        yuyv,
+        yuyv_stride,
+        dest.y.data(), width,
+        dest.u.data(), cw,
+        dest.v.data(), cw,
+        width,
+        height
+      ) != 0
+    )
+      throw_err("YUY2ToI422 failed!");
+  }
+
+  /**
+   * 4:2:2 and 4:2:0 pack directly, other layouts are resampled first.
+   * YUYV is limited range: full range planes are squeezed first.
+   */
+  void encodeYUV(const YUVFrame& frame, uint8_t* yuyv, size_t* /* size */) override
+  {
+    if (frame.width != width || frame.height != height)
+      throw_err("YUVFrame size differs from the device!!!");
+    if (frame.full_range)
+      convert_range(frame, range_buf, false);
+    const YUVFrame& src = frame.full_range ? range_buf : frame;
+
+    const int cw = (width + 1) / 2;
+    const uint8_t* u = src.u.data();
+    const uint8_t* v = src.v.data();
+    int ret;
+    if (src.chroma_w == cw && src.chroma_h == (height + 1) / 2)
+    {
+      ret = libyuv::I420ToYUY2(
+        src.y.data(), width, u, cw, v, cw,
+        yuyv, yuyv_stride, width, height
+      );
+    }
+    else
+    {
+      if (src.chroma_w != cw || src.chroma_h != height)
+      {
+        chroma[0].resize((size_t)cw * height);
+        chroma[1].resize((size_t)cw * height);
+        libyuv::ScalePlane(
+          u, src.chroma_w, src.chroma_w, src.chroma_h,
+          chroma[0].data(), cw, cw, height, libyuv::kFilterBox
+        );
+        libyuv::ScalePlane(
+          v, src.chroma_w, src.chroma_w, src.chroma_h,
+          chroma[1].data(), cw, cw, height, libyuv::kFilterBox
+        );
+        u = chroma[0].data();
+        v = chroma[1].data();
+      }
+      ret = libyuv::I422ToYUY2(
+        src.y.data(), width, u, cw, v, cw,
+        yuyv, yuyv_stride, width, height
+      );
+    }
+    if (ret != 0)
+      throw_err("I4xxToYUY2 failed!");
+  }
+
 private:
   std::vector<uint8_t> vec_argb_buffer;
   uint8_t* argb_buffer;
 
+  // encodeYUV: chroma resampled to 4:2:2, planes in limited range
+  std::vector<uint8_t> chroma[2];
+  YUVFrame range_buf;
+
   const int width;
   const int height;
   const int yuyv_stride;
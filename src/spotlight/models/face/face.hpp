@@ -15,8 +15,15 @@
 #include <string>
 #include <limits>
 #include <vector>
+#include <algorithm>
+#include <type_traits>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 #include <spotlight/models/model.hpp>
+#include <spotlight/utils/math_utils.hpp>
 #include <spotlight/models/face/face_utils.hpp>
 
 
@@ -46,18 +53,26 @@ class FaceDetection
     const float temporal_alpha,
     const float jerk_tolerance,
     const std::string& model_path,
-    const int num_threads
+    const InferenceConfig& config
   )
-    : top_k(top_k), score_threshold(score_threshold),
-      iou_threshold(iou_threshold), temporal_alpha(temporal_alpha),
-      jerk_tolerance(jerk_tolerance), model(model_path, num_threads)
+    : model(model_path, config), top_k(top_k),
+      score_threshold(score_threshold), iou_threshold(iou_threshold),
+      temporal_alpha(temporal_alpha), jerk_tolerance(jerk_tolerance)
   {
     scores_tensor = model.getOutputTensor(0);
     boxes_tensor = model.getOutputTensor(1);
+    scores_quant = model.getOutputQuant(0);
+    boxes_quant = model.getOutputQuant(1);
 
     generate_priors();
-    selections.assign(priors.size(), true);
-    detections.assign(priors.size(), Detection{});
+    const size_t num_priors = prior_cx.size();
+    candidates.resize(num_priors);
+    cand_score.resize(num_priors);
+    cand_x.resize(num_priors);
+    cand_y.resize(num_priors);
+    cand_w.resize(num_priors);
+    cand_h.resize(num_priors);
+    detections.resize(num_priors);
 
     face_frame = {
       0.f, 0.f, (float)ModelWidth(), (float)ModelHeight(), 0.f
@@ -71,88 +86,239 @@ class FaceDetection
     return postProcess();
   }
 
+  /* Runs on whatever was written through getInputTensor(). */
+  Detection invoke()
+  {
+    model.invoke();
+    return postProcess();
+  }
+
+  ModelType* getInputTensor() { return model.getInputTensor(); }
+
+  /**
+   * UltraFace wants RGB as (v - 127) / 128 (or its quantization). A
+   * [0, 255] pixel v maps to v * InputAlpha() + InputBeta().
+   */
+  float InputAlpha() const
+  {
+    const QuantParams q = model.getInputQuant();
+    return q.scale > 0.f ? 1.f / (128.f * q.scale) : 1.f / 128.f;
+  }
+
+  float InputBeta() const
+  {
+    const QuantParams q = model.getInputQuant();
+    return q.scale > 0.f
+         ? q.zero_point - 127.f / (128.f * q.scale)
+         : -127.f / 128.f;
+  }
+
   Detection postProcess()
   {
     const Point frame_center = face_frame.center();
-    const int n = std::min(top_k, getDetections());
+    const int n = getDetections();
 
     int min_idx = -1;
     float min_dist = std::numeric_limits<float>::infinity();
     for (int i = 0; i < n; i++)
     {
-      if (!selections[i])
-        continue;
-
       const float cur_dist = frame_center.distSq(detections[i].center());
 
       if (min_dist > cur_dist)
         min_idx = i, min_dist = cur_dist;
     }
 
-    if (min_idx != -1)
+    // The score tells whether this inference found a face at all
+    face_frame.score = 0.f;
+    if (min_idx != -1 && stabilize)
+    {
       face_frame.stablize(detections[min_idx], temporal_alpha, jerk_tolerance);
+      face_frame.score = detections[min_idx].score;
+    }
+    else if (min_idx != -1)
+    {
+      face_frame = detections[min_idx];
+    }
 
     return face_frame;
   }
 
+  /**
+   * Faces of the last inference, best first, at most top_k after NMS.
+   * Only priors that pass the score threshold are dequantized and decoded.
+   */
   int getDetections()
   {
-    int num_detects = 0;
-    for (size_t i = 0; i < priors.size(); i++)
+    const int n = selectCandidates();
+    for (int i = 0; i < n; i++)
     {
-      const float score = scores_tensor[2 * i + 1];
-      if (score < score_threshold)
-        continue;
+      const int p = candidates[i];
+      cand_score[i] = dequantize(scores_tensor[2 * p + 1], scores_quant);
+      cand_x[i] = dequantize(boxes_tensor[4 * p + 0], boxes_quant);
+      cand_y[i] = dequantize(boxes_tensor[4 * p + 1], boxes_quant);
+      cand_w[i] = dequantize(boxes_tensor[4 * p + 2], boxes_quant);
+      cand_h[i] = dequantize(boxes_tensor[4 * p + 3], boxes_quant);
+    }
+    decodeBoxes(n);
 
-      const Prior& p = priors[i];
+    for (int i = 0; i < n; i++)
+      detections[i] = {cand_x[i], cand_y[i], cand_w[i], cand_h[i], cand_score[i]};
 
-      const float cx = boxes_tensor[4*i+0] * center_variance * p.w + p.cx;
-      const float cy = boxes_tensor[4*i+1] * center_variance * p.h + p.cy;
-      const float w  = expf(boxes_tensor[4*i+2] * size_variance) * p.w;
-      const float h  = expf(boxes_tensor[4*i+3] * size_variance) * p.h;
+    return NonMaxSuppression(n);
+  }
+
+  /**
+   * Collects the priors whose face score reaches score_threshold into
+   * `candidates` (in no particular order). Quantized scores are compared
+   * as integers against the quantized threshold.
+   */
+  int selectCandidates()
+  {
+    const int n = (int)prior_cx.size();
+    int num = 0;
+    int i = 0;
 
-      const float x1 = (cx - w * 0.5f) * ModelWidth();
-      const float y1 = (cy - h * 0.5f) * ModelHeight();
-      const float x2 = (cx + w * 0.5f) * ModelWidth();
-      const float y2 = (cy + h * 0.5f) * ModelHeight();
+    if constexpr (std::is_floating_point_v<ModelType>)
+    {
+#ifdef __AVX2__
+      // Face scores are the odd lanes; the shuffle leaves priors in the
+      // order 0 1 4 5 2 3 6 7.
+      static constexpr int lane_prior[] = {0, 1, 4, 5, 2, 3, 6, 7};
+      const __m256 thr = _mm256_set1_ps(score_threshold);
+      for (; i + 8 <= n; i += 8)
+      {
+        const __m256 a = _mm256_loadu_ps(scores_tensor + 2 * i);
+        const __m256 b = _mm256_loadu_ps(scores_tensor + 2 * i + 8);
+        const __m256 face = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(face, thr, _CMP_GE_OQ));
+        for (; mask; mask &= mask - 1)
+          candidates[num++] = i + lane_prior[__builtin_ctz(mask)];
+      }
+#endif
+      for (; i < n; i++)
+        if (scores_tensor[2 * i + 1] >= score_threshold)
+          candidates[num++] = i;
+    }
+    else
+    {
+      // scale * (q - zp) >= threshold  <=>  q >= zp + threshold / scale
+      const float qf = ceilf(
+        scores_quant.zero_point + score_threshold / scores_quant.scale
+      );
+      if (qf > std::numeric_limits<ModelType>::max())
+        return 0;
+      const int qmin = std::max(
+        (int)qf, (int)std::numeric_limits<ModelType>::lowest()
+      );
 
-      detections[num_detects++] = {x1, y1, x2, y2, score};
+#ifdef __AVX2__
+      const __m256i thr = _mm256_set1_epi8((char)qmin);
+      for (; i + 16 <= n; i += 16)
+      {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)(scores_tensor + 2 * i));
+        __m256i hi;
+        if constexpr (std::is_signed_v<ModelType>)
+          hi = _mm256_max_epi8(v, thr);
+        else
+          hi = _mm256_max_epu8(v, thr);
+        // Odd bytes are the face scores
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+          _mm256_cmpeq_epi8(hi, v)
+        ) & 0xAAAAAAAAu;
+        for (; mask; mask &= mask - 1)
+          candidates[num++] = i + (__builtin_ctz(mask) >> 1);
+      }
+#endif
+      for (; i < n; i++)
+        if ((int)scores_tensor[2 * i + 1] >= qmin)
+          candidates[num++] = i;
     }
-    NonMaxSuppression(num_detects);
 
-    return num_detects;
+    return num;
   }
 
-  void NonMaxSuppression(int n)
+  /**
+   * Turns the n gathered (cand_x, cand_y, cand_w, cand_h) prior offsets
+   * into (x1, y1, x2, y2) boxes in model pixels, in place.
+   */
+  void decodeBoxes(const int n)
   {
-    if (n > top_k)
+    const float mw = (float)ModelWidth();
+    const float mh = (float)ModelHeight();
+    int i = 0;
+
+#ifdef __AVX2__
+    const __m256 cv = _mm256_set1_ps(center_variance);
+    const __m256 sv = _mm256_set1_ps(size_variance);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 vmw = _mm256_set1_ps(mw);
+    const __m256 vmh = _mm256_set1_ps(mh);
+    for (; i + 8 <= n; i += 8)
     {
-      std::nth_element(
-          detections.begin(),
-          detections.begin() + top_k,
-          detections.begin() + n,
-          [](const Detection& a, const Detection& b) {
-            return a.score > b.score;
-          }
+      const __m256i idx = _mm256_loadu_si256((const __m256i*)(candidates.data() + i));
+      const __m256 pcx = _mm256_i32gather_ps(prior_cx.data(), idx, 4);
+      const __m256 pcy = _mm256_i32gather_ps(prior_cy.data(), idx, 4);
+      const __m256 pw = _mm256_i32gather_ps(prior_w.data(), idx, 4);
+      const __m256 ph = _mm256_i32gather_ps(prior_h.data(), idx, 4);
+
+      const __m256 cx = _mm256_add_ps(
+        _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(&cand_x[i]), cv), pw), pcx
       );
-      n = top_k;
+      const __m256 cy = _mm256_add_ps(
+        _mm256_mul_ps(_mm256_mul_ps(_mm256_loadu_ps(&cand_y[i]), cv), ph), pcy
+      );
+      const __m256 hw = _mm256_mul_ps(_mm256_mul_ps(
+        fast_exp(_mm256_mul_ps(_mm256_loadu_ps(&cand_w[i]), sv)), pw
+      ), half);
+      const __m256 hh = _mm256_mul_ps(_mm256_mul_ps(
+        fast_exp(_mm256_mul_ps(_mm256_loadu_ps(&cand_h[i]), sv)), ph
+      ), half);
+
+      _mm256_storeu_ps(&cand_x[i], _mm256_mul_ps(_mm256_sub_ps(cx, hw), vmw));
+      _mm256_storeu_ps(&cand_y[i], _mm256_mul_ps(_mm256_sub_ps(cy, hh), vmh));
+      _mm256_storeu_ps(&cand_w[i], _mm256_mul_ps(_mm256_add_ps(cx, hw), vmw));
+      _mm256_storeu_ps(&cand_h[i], _mm256_mul_ps(_mm256_add_ps(cy, hh), vmh));
+    }
+#endif
+    for (; i < n; i++)
+    {
+      const int p = candidates[i];
+      const float cx = cand_x[i] * center_variance * prior_w[p] + prior_cx[p];
+      const float cy = cand_y[i] * center_variance * prior_h[p] + prior_cy[p];
+      const float hw = fast_exp(cand_w[i] * size_variance) * prior_w[p] * 0.5f;
+      const float hh = fast_exp(cand_h[i] * size_variance) * prior_h[p] * 0.5f;
+
+      cand_x[i] = (cx - hw) * mw;
+      cand_y[i] = (cy - hh) * mh;
+      cand_w[i] = (cx + hw) * mw;
+      cand_h[i] = (cy + hh) * mh;
     }
+  }
+
+  /**
+   * Greedy NMS over the first n detections: best score first, each box is
+   * only checked against the boxes already kept, and it stops once top_k
+   * are kept. The kept boxes are moved to the front; returns their count.
+   */
+  int NonMaxSuppression(const int n)
+  {
     std::sort(detections.begin(), detections.begin() + n,
         [](const Detection& a, const Detection& b) {
           return a.score > b.score;
         }
     );
 
-    std::fill(selections.begin(), selections.begin()+n, true);
-    for (int i = 0; i < n; i++)
+    int kept = 0;
+    for (int i = 0; i < n && kept < top_k; i++)
     {
-      if (!selections[i])
-        continue;
+      bool keep = true;
+      for (int j = 0; j < kept && keep; j++)
+        keep = detections[j].iou(detections[i]) <= iou_threshold;
 
-      for (int j = i + 1; j < n; j++)
-        if (selections[j] && detections[i].iou(detections[j]) > iou_threshold)
-          selections[j] = false;
+      if (keep)
+        detections[kept++] = detections[i];
     }
+    return kept;
   }
 
   void generate_priors()
@@ -177,13 +343,24 @@ class FaceDetection
           for (int b = 0; b < box_counts[s]; b++)
           {
             const float box = min_boxes[s][b];
-            priors.push_back({cx, cy, box * invW, box * invH});
+            prior_cx.push_back(cx);
+            prior_cy.push_back(cy);
+            prior_w.push_back(box * invW);
+            prior_h.push_back(box * invH);
           }
         }
       }
     }
   }
 
+  /**
+   * Off: invoke() returns the matched detection as it is, for a caller
+   * that filters the boxes itself (FaceTracker).
+   */
+  void setStabilize(const bool on) { stabilize = on; }
+
+  const ModelTimings& Timings() const { return model.getTimings(); }
+
   int ModelWidth() const { return model.ModelWidth(); }
   int ModelHeight() const { return model.ModelHeight(); }
   int ModelPixels() const { return model.ModelWidth() * model.ModelHeight(); }
@@ -196,9 +373,31 @@ class FaceDetection
 
   ModelType* boxes_tensor;
 
-  std::vector<Prior> priors;
+  QuantParams scores_quant;
+
+  QuantParams boxes_quant;
+
+  // Priors, one array per field
+  std::vector<float> prior_cx;
+
+  std::vector<float> prior_cy;
+
+  std::vector<float> prior_w;
+
+  std::vector<float> prior_h;
 
-  std::vector<bool> selections;
+  // Priors above score_threshold, their scores and boxes
+  std::vector<int> candidates;
+
+  std::vector<float> cand_score;
+
+  std::vector<float> cand_x;
+
+  std::vector<float> cand_y;
+
+  std::vector<float> cand_w;
+
+  std::vector<float> cand_h;
 
   std::vector<Detection> detections;
 
@@ -213,6 +412,8 @@ class FaceDetection
   const float temporal_alpha;
 
   const float jerk_tolerance;
+
+  bool stabilize = true;
 };
 
 } // namespace spotlight
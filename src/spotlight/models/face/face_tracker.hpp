@@ -0,0 +1,160 @@
+/**
+ * @file face_tracker.hpp
+ * @author Ranjodh Singh
+ *
+ * @brief FACE_TRACKER.
+ *
+ * Copyright (c) 2026 Ranjodh Singh
+ * This file is licensed under the MIT License.
+ * You may obtain a copy of the License at https://opensource.org/license/MIT.
+ */
+#ifndef FACE_TRACKER_HPP
+#define FACE_TRACKER_HPP
+
+#include <cmath>
+
+#include <spotlight/models/face/face_utils.hpp>
+
+
+namespace spotlight {
+
+/**
+ * Constant velocity Kalman filter on a face box, predicting it on the
+ * frames between two detections.
+ *
+ * Center x, center y, width and height are filtered independently, each
+ * with its own velocity (pixels / frame). Both noises are given as a
+ * fraction of the box width, so near and far faces are tracked alike.
+ *
+ * The tracker is confident while the last detection found a face within
+ * max_jump box widths (summed over the 4 coordinates) of the prediction.
+ */
+class FaceTracker
+{
+ public:
+  FaceTracker(
+    const float process_noise,
+    const float measure_noise,
+    const float max_jump
+  )
+    : process_noise(process_noise), measure_noise(measure_noise),
+      max_jump(max_jump)
+  {}
+
+  /* Moves the box one frame ahead. */
+  void predict()
+  {
+    if (!initialized)
+      return;
+
+    const float q = sq(process_noise * axes[2].x);
+    for (Axis& a : axes)
+      a.predict(q);
+  }
+
+  /**
+   * Fuses a detection made `lag` frames ago (0: on this frame).
+   * A zero score means the detector found no face.
+   */
+  void correct(const Detection& det, const int lag)
+  {
+    if (det.score <= 0.f)
+    {
+      for (Axis& a : axes)
+        a.v = 0.f;
+      confident = false;
+      return;
+    }
+
+    const Point c = det.center();
+    const float z[4] = {c.x, c.y, det.width(), det.height()};
+    const float r = sq(measure_noise * det.width());
+    score = det.score;
+
+    if (!initialized)
+    {
+      for (int i = 0; i < 4; i++)
+        axes[i] = {z[i], 0.f, r, 0.f, r};
+      initialized = true;
+      confident = true;
+      return;
+    }
+
+    float jump = 0.f;
+    for (int i = 0; i < 4; i++)
+    {
+      // Seen `lag` frames ago, carried to now at the current velocity
+      const float zi = z[i] + axes[i].v * lag;
+      jump += std::abs(zi - axes[i].x);
+      axes[i].correct(zi, r);
+    }
+    confident = jump < max_jump * axes[2].x;
+  }
+
+  /* Predicted box for this frame, with the last detection's score. */
+  Detection box() const
+  {
+    const float hw = 0.5f * axes[2].x;
+    const float hh = 0.5f * axes[3].x;
+    return {
+      axes[0].x - hw, axes[1].x - hh,
+      axes[0].x + hw, axes[1].x + hh,
+      score
+    };
+  }
+
+  bool Tracking() const { return initialized; }
+  bool Confident() const { return initialized && confident; }
+
+ private:
+  static float sq(const float x) { return x * x; }
+
+  /* Position and velocity with their 2x2 (symmetric) covariance. */
+  struct Axis
+  {
+    float x, v;
+    float p00, p01, p11;
+
+    // F = [1 1; 0 1], Q = q * [1/4 1/2; 1/2 1] (white acceleration)
+    void predict(const float q)
+    {
+      x += v;
+      p00 += 2.f * p01 + p11 + 0.25f * q;
+      p01 += p11 + 0.5f * q;
+      p11 += q;
+    }
+
+    // H = [1 0]
+    void correct(const float z, const float r)
+    {
+      const float s = p00 + r;
+      const float k0 = p00 / s;
+      const float k1 = p01 / s;
+      const float y = z - x;
+
+      x += k0 * y;
+      v += k1 * y;
+      p11 -= k1 * p01;
+      p01 -= k0 * p01;
+      p00 -= k0 * p00;
+    }
+  };
+
+  Axis axes[4] = {};
+
+  float score = 0.f;
+
+  bool initialized = false;
+
+  bool confident = false;
+
+  const float process_noise;
+
+  const float measure_noise;
+
+  const float max_jump;
+};
+
+} // namespace spotlight
+
+#endif // FACE_TRACKER_HPP
@@ -16,10 +16,6 @@
 
 namespace spotlight {
 
-struct Prior {
-  float cx, cy, w, h;
-};
-
 struct Point
 {
   float x, y;
@@ -106,6 +102,14 @@ struct Detection
     y2 += h * bottom;
   }
 
+  void shift(const float dx, const float dy)
+  {
+    x1 += dx;
+    y1 += dy;
+    x2 += dx;
+    y2 += dy;
+  }
+
   void scale(const float factorW, const float factorH)
   {
     x1 *= factorW;
@@ -11,39 +11,266 @@
 #ifndef MODEL_HPP
 #define MODEL_HPP
 
+#include <chrono>
+#include <memory>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+#include <unistd.h>
+
 #include <tensorflow/lite/model.h>
 #include <tensorflow/lite/interpreter.h>
 #include <tensorflow/lite/kernels/register.h>
+#include <tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h>
+
+#include <spotlight/config/config.hpp>
+#include <spotlight/models/op_resolver.hpp>
+#include <spotlight/utils/error_utils.hpp>
+#include <spotlight/utils/mapped_file.hpp>
 
 
 namespace spotlight {
 
+/* scale == 0 means the tensor is not quantized. */
+struct QuantParams
+{
+  float scale = 0.f;
+  int zero_point = 0;
+};
+
+/* Startup cost of a Model, in milliseconds. */
+struct ModelTimings
+{
+  double load = 0.0;
+  double delegate = 0.0;
+  double allocate = 0.0;
+};
+
+template <typename T>
+constexpr TfLiteType tensor_type()
+{
+  if constexpr (std::is_same_v<T, float>)
+    return kTfLiteFloat32;
+  else if constexpr (std::is_same_v<T, uint8_t>)
+    return kTfLiteUInt8;
+  else if constexpr (std::is_same_v<T, int8_t>)
+    return kTfLiteInt8;
+  else
+    static_assert(!sizeof(T), "Unsupported ModelType");
+}
+
+template <typename T>
+inline float dequantize(const T v, const QuantParams& q)
+{
+  if constexpr (std::is_floating_point_v<T>)
+    return (float)v;
+  else
+    return q.scale * ((int)v - q.zero_point);
+}
+
 template <typename ModelType>
 class Model
 {
  public:
 
-  Model(const std::string& model_path, const int num_threads)
-    : model_path(model_path), num_threads(num_threads)
+  Model(const std::string& model_path, const InferenceConfig& config)
+    : model_path(model_path), config(config)
   {
-    model = tflite::FlatBufferModel::BuildFromFile(model_path.c_str());
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+
+    file = std::make_shared<MappedFile>(model_path);
+    model = tflite::FlatBufferModel::BuildFromBuffer(file->data(), file->size());
     if (model == nullptr)
       throw std::runtime_error("Failed to load model from " + model_path);
 
-    tflite::InterpreterBuilder(*model, resolver)(&interpreter);
+    resolver = std::make_shared<SpotlightOpResolver>();
+    tflite::InterpreterBuilder(*model, *resolver)(&interpreter);
+    if (interpreter == nullptr)
+    {
+      log_err("Unlisted ops, using all builtin ops for: " + model_path);
+      resolver = std::make_shared<
+        tflite::ops::builtin::BuiltinOpResolverWithoutDefaultDelegates
+      >();
+      tflite::InterpreterBuilder(*model, *resolver)(&interpreter);
+    }
     if (interpreter == nullptr)
       throw std::runtime_error("Failed to build interpreter for " + model_path);
+    timings.load = elapsed(start, clock::now());
+
+    init();
+  }
 
-    interpreter->SetNumThreads(num_threads);
+  /**
+   * One more interpreter on the mapping, FlatBufferModel and resolver of
+   * `shared`, at its current input size. Interpreters own their tensors
+   * and delegate, so each one can be invoked from its own thread.
+   */
+  Model(const Model& shared, const InferenceConfig& config)
+    : file(shared.file),
+      model(shared.model),
+      resolver(shared.resolver),
+      model_path(shared.model_path),
+      config(config)
+  {
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
 
+    tflite::InterpreterBuilder(*model, *resolver)(&interpreter);
+    if (interpreter == nullptr)
+      throw std::runtime_error("Failed to build interpreter for " + model_path);
+    timings.load = elapsed(start, clock::now());
+
+    init();
+    resizeInput(shared.modW, shared.modH);
+  }
+
+  /* Delegate, tensors and input checks of a freshly built interpreter. */
+  void init()
+  {
+    using clock = std::chrono::steady_clock;
+
+    interpreter->SetNumThreads(config.n_threads);
+
+    auto start = clock::now();
+    if (config.xnnpack)
+      applyXNNPack();
+    timings.delegate = elapsed(start, clock::now());
+    checkCustomOps();
+
+    start = clock::now();
     if (interpreter->AllocateTensors() != TfLiteStatus::kTfLiteOk)
       throw std::runtime_error("Failed to allocate tensors for " + model_path);
+    timings.allocate = elapsed(start, clock::now());
 
-    modH = interpreter->input_tensor(0)->dims->data[1];
-    modW = interpreter->input_tensor(0)->dims->data[2];
+    const TfLiteTensor* input = interpreter->input_tensor(0);
+    if (input->type != tensor_type<ModelType>())
+      throw std::runtime_error("Input tensor type mismatch for " + model_path);
+
+    // Outputs are read as ModelType too (e.g. int8 in, float32 out is not)
+    for (size_t i = 0; i < interpreter->outputs().size(); i++)
+    {
+      if (interpreter->output_tensor(i)->type != tensor_type<ModelType>())
+        throw std::runtime_error(
+          "Output tensor " + std::to_string(i) + " type mismatch for " +
+          model_path
+        );
+    }
+
+    modH = input->dims->data[1];
+    modW = input->dims->data[2];
+    input_quant = {input->params.scale, input->params.zero_point};
     input_tensor = interpreter->typed_input_tensor<ModelType>(0);
   }
 
+  /**
+   * The resolver carries no default delegates, so this is the only XNNPACK
+   * instance. Packed weights are persisted to <model>.xnnpack_cache and
+   * mapped back on the next start instead of being repacked.
+   */
+  void applyXNNPack()
+  {
+    TfLiteXNNPackDelegateOptions options = TfLiteXNNPackDelegateOptionsDefault();
+    options.num_threads = config.n_threads;
+    options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_QS8;
+    options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_QU8;
+    if (config.xnnpack_fp16)
+      options.flags |= TFLITE_XNNPACK_DELEGATE_FLAG_FORCE_FP16;
+
+    if (config.xnnpack_cache)
+    {
+      const size_t slash = model_path.find_last_of('/');
+      const std::string dir = (
+        slash == std::string::npos ? "." : model_path.substr(0, slash)
+      );
+      if (access(dir.c_str(), W_OK) == 0)
+      {
+        weight_cache_path = model_path + ".xnnpack_cache";
+        options.weight_cache_file_path = weight_cache_path.c_str();
+      }
+      else
+      {
+        log_errno("XNNPACK weight cache disabled for: " + model_path);
+      }
+    }
+
+    delegate.reset(TfLiteXNNPackDelegateCreate(&options));
+    if (delegate == nullptr)
+      throw std::runtime_error("Failed to create XNNPACK for " + model_path);
+
+    if (interpreter->ModifyGraphWithDelegate(delegate.get()) != kTfLiteOk)
+      log_err("XNNPACK rejected, using builtin kernels for: " + model_path);
+  }
+
+  /**
+   * Custom ops missing from the resolver are kept by the InterpreterBuilder
+   * for a delegate to claim (Convolution2DTransposeBias of the segm models
+   * only exists in XNNPACK). One still in the execution plan here can never
+   * run, so it is named now instead of failing in AllocateTensors.
+   */
+  void checkCustomOps()
+  {
+    for (const int idx : interpreter->execution_plan())
+    {
+      const TfLiteRegistration& reg = (
+        interpreter->node_and_registration(idx)->second
+      );
+      if (
+        reg.builtin_code != tflite::BuiltinOperator_CUSTOM ||
+        reg.custom_name == nullptr ||
+        resolver->FindOp(reg.custom_name, reg.version) != nullptr
+      )
+        continue;
+
+      throw std::runtime_error(
+        "Custom op " + std::string(reg.custom_name) + " of " + model_path +
+        " has no kernel without XNNPACK" +
+        (config.xnnpack ? " (rejected the graph)" : " (xnnpack 0)")
+      );
+    }
+  }
+
+  /**
+   * Reshapes the input to 1 x h x w x 3 and reallocates every tensor, so
+   * all tensor pointers taken before are stale afterwards. Only models
+   * without shape dependent ops survive this; on failure the previous shape
+   * is restored and false is returned.
+   */
+  bool resizeInput(const int w, const int h)
+  {
+    if (w == modW && h == modH)
+      return true;
+
+    const int idx = interpreter->inputs()[0];
+    bool ok = (
+      w > 0 && h > 0 &&
+      interpreter->ResizeInputTensor(idx, {1, h, w, 3}) == kTfLiteOk &&
+      interpreter->AllocateTensors() == kTfLiteOk
+    );
+    if (ok)
+    {
+      modW = w;
+      modH = h;
+    }
+    else
+    {
+      log_err(
+        "Failed to resize input to " + std::to_string(w) + "x" +
+        std::to_string(h) + " for " + model_path
+      );
+      if (
+        interpreter->ResizeInputTensor(idx, {1, modH, modW, 3}) != kTfLiteOk ||
+        interpreter->AllocateTensors() != kTfLiteOk
+      )
+        throw std::runtime_error("Failed to restore input for " + model_path);
+    }
+
+    input_tensor = interpreter->typed_input_tensor<ModelType>(0);
+    return ok;
+  }
+
   void setInputTensor(const ModelType* input_pointer)
   {
     std::memcpy(
@@ -53,6 +280,11 @@ class Model
     );
   }
 
+  ModelType* getInputTensor()
+  {
+    return input_tensor;
+  }
+
   void invoke()
   {
     if (interpreter->Invoke() != TfLiteStatus::kTfLiteOk)
@@ -64,27 +296,71 @@ class Model
     return interpreter->typed_output_tensor<ModelType>(idx);
   }
 
+  /* dims[1] x dims[2] of an NHWC output. */
+  bool outputMatches(const int idx, const int w, const int h) const
+  {
+    const TfLiteIntArray* dims = interpreter->output_tensor(idx)->dims;
+    return dims->size == 4 && dims->data[1] == h && dims->data[2] == w;
+  }
+
+  QuantParams getInputQuant() const
+  {
+    return input_quant;
+  }
+
+  QuantParams getOutputQuant(const int idx) const
+  {
+    const TfLiteTensor* output = interpreter->output_tensor(idx);
+    return {output->params.scale, output->params.zero_point};
+  }
+
+  const ModelTimings& getTimings() const
+  {
+    return timings;
+  }
+
   int ModelWidth() const { return modW; }
   int ModelHeight() const { return modH; }
   int ModelPixels() const { return modW * modH; }
 
  private:
 
+  template <typename T>
+  static double elapsed(const T& start, const T& end)
+  {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+  }
+
   int modH;
 
   int modW;
 
   ModelType* input_tensor;
 
-  std::unique_ptr<tflite::FlatBufferModel> model;
+  QuantParams input_quant;
+
+  ModelTimings timings;
+
+  // Shared by every interpreter on this model, must outlive the model.
+  std::shared_ptr<const MappedFile> file;
+
+  std::shared_ptr<const tflite::FlatBufferModel> model;
+
+  // Must outlive the interpreter (it holds pointers to registrations).
+  std::shared_ptr<const tflite::OpResolver> resolver;
+
+  std::string weight_cache_path;
 
-  tflite::ops::builtin::BuiltinOpResolver resolver;
+  // Must outlive the interpreter.
+  std::unique_ptr<TfLiteDelegate, void (*)(TfLiteDelegate*)> delegate{
+    nullptr, TfLiteXNNPackDelegateDelete
+  };
 
   std::unique_ptr<tflite::Interpreter> interpreter;
 
-  const std::string& model_path;
+  const std::string model_path;
 
-  const int num_threads;
+  const InferenceConfig config;
 };
 
 } // namespace spotlight
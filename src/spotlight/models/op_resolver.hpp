@@ -0,0 +1,65 @@
+/**
+ * @file op_resolver.hpp
+ * @author Ranjodh Singh
+ *
+ * @brief OP_RESOLVER.
+ *
+ * Copyright (c) 2026 Ranjodh Singh
+ * This file is licensed under the MIT License.
+ * You may obtain a copy of the License at https://opensource.org/license/MIT.
+ */
+#ifndef OP_RESOLVER_HPP
+#define OP_RESOLVER_HPP
+
+#include <tensorflow/lite/mutable_op_resolver.h>
+#include <tensorflow/lite/kernels/builtin_op_kernels.h>
+
+
+namespace spotlight {
+
+/**
+ * Registers only the builtin ops found in the operator_codes of
+ *   models/segm/segm_lite_v681.tflite
+ *   models/segm/segm_full_v679.tflite
+ *   models/face/face_smpl_320p.tflite
+ * at the op versions they use: all 1 but DEQUANTIZE, up to 2. Regenerate
+ * when a model is added (int8 models use higher versions of most ops).
+ *
+ * The segm models also use the MediaPipe custom op
+ * Convolution2DTransposeBias, which is only implemented by XNNPACK:
+ * Model::checkCustomOps() names it when XNNPACK is off or rejected.
+ */
+class SpotlightOpResolver : public tflite::MutableOpResolver
+{
+ public:
+  SpotlightOpResolver()
+  {
+    using namespace tflite::ops::builtin;
+
+    // segm + face
+    AddBuiltin(tflite::BuiltinOperator_CONCATENATION, Register_CONCATENATION());
+    AddBuiltin(tflite::BuiltinOperator_CONV_2D, Register_CONV_2D());
+    AddBuiltin(tflite::BuiltinOperator_DEPTHWISE_CONV_2D, Register_DEPTHWISE_CONV_2D());
+
+    // segm
+    AddBuiltin(tflite::BuiltinOperator_ADD, Register_ADD());
+    AddBuiltin(tflite::BuiltinOperator_AVERAGE_POOL_2D, Register_AVERAGE_POOL_2D());
+    AddBuiltin(tflite::BuiltinOperator_DEQUANTIZE, Register_DEQUANTIZE(), 1, 2);
+    AddBuiltin(tflite::BuiltinOperator_FULLY_CONNECTED, Register_FULLY_CONNECTED());
+    AddBuiltin(tflite::BuiltinOperator_HARD_SWISH, Register_HARD_SWISH());
+    AddBuiltin(tflite::BuiltinOperator_LOGISTIC, Register_LOGISTIC());
+    AddBuiltin(tflite::BuiltinOperator_MUL, Register_MUL());
+    AddBuiltin(tflite::BuiltinOperator_RELU, Register_RELU());
+    AddBuiltin(tflite::BuiltinOperator_RELU6, Register_RELU6());
+    AddBuiltin(tflite::BuiltinOperator_RESIZE_BILINEAR, Register_RESIZE_BILINEAR());
+
+    // face
+    AddBuiltin(tflite::BuiltinOperator_PAD, Register_PAD());
+    AddBuiltin(tflite::BuiltinOperator_RESHAPE, Register_RESHAPE());
+    AddBuiltin(tflite::BuiltinOperator_SOFTMAX, Register_SOFTMAX());
+  }
+};
+
+} // namespace spotlight
+
+#endif // OP_RESOLVER_HPP
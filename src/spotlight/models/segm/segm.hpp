@@ -11,7 +11,11 @@
 #ifndef SEGM_HPP
 #define SEGM_HPP
 
+#include <cstdint>
+#include <type_traits>
+
 #include <spotlight/models/model.hpp>
+#include <spotlight/utils/math_utils.hpp>
 
 
 namespace spotlight {
@@ -21,39 +25,163 @@ class SelfieSegmentation
 {
  public:
 
-  SelfieSegmentation(const std::string& model_path, const int num_threads)
-    : model(model_path, num_threads)
+  SelfieSegmentation(
+    const std::string& model_path, const InferenceConfig& config
+  )
+    : model(model_path, config)
+  {
+    mask_tensor = model.getOutputTensor(0);
+    mask_quant = model.getOutputQuant(0);
+  }
+
+  /* Second interpreter sharing the model of `shared`, see Model. */
+  SelfieSegmentation(
+    const SelfieSegmentation& shared, const InferenceConfig& config
+  )
+    : model(shared.model, config)
   {
     mask_tensor = model.getOutputTensor(0);
+    mask_quant = model.getOutputQuant(0);
   }
 
   // Note: bg - 0, fg - 1
-  void invoke(const ModelType* input, ModelType* output)
+  template <typename oT>
+  void invoke(const ModelType* input, oT* output)
   {
     model.setInputTensor(input);
     model.invoke();
     postProcess(output);
   }
 
-  void postProcess(ModelType* output)
+  /* Runs on whatever was written through getInputTensor(). */
+  template <typename oT>
+  void invoke(oT* output)
   {
-    // background - 2*i+0, forground - 2*i+1
-    for (int i = 0; i < ModelHeight() * ModelWidth(); i++)
+    model.invoke();
+    postProcess(output);
+  }
+
+  ModelType* getInputTensor() { return model.getInputTensor(); }
+
+  /**
+   * Runs the model at w x h instead of its native input size. The mask
+   * must come out at the same size, otherwise the old size is kept.
+   */
+  bool resize(const int w, const int h)
+  {
+    const int prev_w = ModelWidth();
+    const int prev_h = ModelHeight();
+
+    bool ok = model.resizeInput(w, h);
+    if (ok && !model.outputMatches(0, w, h))
     {
-      // const float exp_fg = expf(mask_tensor[2*i+1]);
-      // const float exp_bg = expf(mask_tensor[2*i+0]);
-      // const float prob_fg = exp_fg / (exp_bg + exp_fg);
-      // const float prob_bg = exp_bg / (exp_bg + exp_fg);
+      log_err("Segmentation mask does not follow the input size!!!");
+      model.resizeInput(prev_w, prev_h);
+      ok = false;
+    }
 
-      output[i] = mask_tensor[2*i] < mask_tensor[2*i+1];
+    mask_tensor = model.getOutputTensor(0);
+    return ok;
+  }
 
-      // output[i] = mask_tensor[2*i] < mask_tensor[2*i+1];
-      // output[3*i+0] = mask_tensor[2*i] < mask_tensor[2*i+1];
-      // output[3*i+1] = mask_tensor[2*i] < mask_tensor[2*i+1];
-      // output[3*i+2] = mask_tensor[2*i] < mask_tensor[2*i+1];
+  /**
+   * The model wants RGB in [0, 1] (or its quantization). A [0, 255] pixel
+   * v maps to v * InputAlpha() + InputBeta() in the input tensor.
+   */
+  float InputAlpha() const
+  {
+    const QuantParams q = model.getInputQuant();
+    return q.scale > 0.f ? 1.f / (255.f * q.scale) : 1.f / 255.f;
+  }
+
+  float InputBeta() const
+  {
+    const QuantParams q = model.getInputQuant();
+    return q.scale > 0.f ? (float)q.zero_point : 0.f;
+  }
+
+  /**
+   * Soft mask: softmax over {bg, fg} is sigmoid(fg - bg).
+   * float outputs are in [0, 1], uint8_t outputs in [0, 255].
+   * Quantized logits share a zero point, so fg - bg = scale * (qfg - qbg).
+   */
+  template <typename oT>
+  void postProcess(oT* output)
+  {
+    constexpr bool u8 = std::is_same_v<oT, uint8_t>;
+    constexpr float scale = u8 ? 255.f : 1.f;
+    constexpr float round = u8 ? 0.5f : 0.f;
+    const float logit_scale = (
+      std::is_floating_point_v<ModelType> ? 1.f : mask_quant.scale
+    );
+
+    int i = 0;
+    const int n = ModelPixels();
+#ifdef __AVX2__
+    if constexpr (u8 || std::is_same_v<oT, float>)
+    {
+      const __m256 vscale = _mm256_set1_ps(scale);
+      const __m256 vlogit = _mm256_set1_ps(logit_scale);
+      const __m256i bg_fg = _mm256_set1_epi32(0x0001FFFF); // (-1, +1) pairs
+      for (; i + 8 <= n; i += 8)
+      {
+        __m256 diff;
+        if constexpr (std::is_same_v<ModelType, float>)
+        {
+          // hsub gives bg - fg for pixels (0 1 4 5 2 3 6 7) of both loads
+          const __m256 a = _mm256_loadu_ps(mask_tensor + 2 * i);
+          const __m256 b = _mm256_loadu_ps(mask_tensor + 2 * i + 8);
+          diff = _mm256_sub_ps(
+            _mm256_setzero_ps(),
+            _mm256_castpd_ps(
+              _mm256_permute4x64_pd(
+                _mm256_castps_pd(_mm256_hsub_ps(a, b)), 0b11011000
+              )
+            )
+          );
+        }
+        else
+        {
+          // Widen 8 {bg, fg} pairs to i16, madd by (-1, +1) gives fg - bg
+          const __m128i q = _mm_loadu_si128((const __m128i*)(mask_tensor + 2 * i));
+          const __m256i q16 = std::is_same_v<ModelType, int8_t>
+                            ? _mm256_cvtepi8_epi16(q)
+                            : _mm256_cvtepu8_epi16(q);
+          diff = _mm256_mul_ps(
+            _mm256_cvtepi32_ps(_mm256_madd_epi16(q16, bg_fg)), vlogit
+          );
+        }
+
+        const __m256 prob = _mm256_mul_ps(fast_sigmoid(diff), vscale);
+        if constexpr (u8)
+        {
+          const __m256i v32 = _mm256_cvtps_epi32(prob);
+          const __m128i v16 = _mm_packs_epi32(
+            _mm256_castsi256_si128(v32), _mm256_extracti128_si256(v32, 1)
+          );
+          _mm_storel_epi64(
+            (__m128i*)(output + i), _mm_packus_epi16(v16, v16)
+          );
+        }
+        else
+        {
+          _mm256_storeu_ps(output + i, prob);
+        }
+      }
+    }
+#endif
+    // background - 2*i+0, forground - 2*i+1
+    for (; i < n; i++)
+    {
+      const float diff = logit_scale * (
+        (float)mask_tensor[2*i+1] - (float)mask_tensor[2*i]
+      );
+      output[i] = (oT)(scale * fast_sigmoid(diff) + round);
     }
   }
 
+  const ModelTimings& Timings() const { return model.getTimings(); }
+
   int ModelWidth() const { return model.ModelWidth(); }
   int ModelHeight() const { return model.ModelHeight(); }
   int ModelPixels() const { return model.ModelWidth() * model.ModelHeight(); }
@@ -62,6 +190,8 @@ class SelfieSegmentation
 
   ModelType* mask_tensor;
 
+  QuantParams mask_quant;
+
   Model<ModelType> model;
 };
 
@@ -11,58 +11,130 @@
 #ifndef PIPELINE_HPP
 #define PIPELINE_HPP
 
+#include <mutex>
+#include <memory>
+#include <optional>
 #include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
 #include <spotlight/config/config.hpp>
 #include <spotlight/config/defaults.hpp>
+#include <spotlight/models/face/face.hpp>
+#include <spotlight/models/face/face_tracker.hpp>
+#include <spotlight/pipeline/scheduler.hpp>
 #include <spotlight/models/segm/segm.hpp>
 #include <spotlight/utils/load_png.hpp>
+#include <spotlight/utils/stats.hpp>
+#include <spotlight/utils/worker.hpp>
+#include <spotlight/utils/pyramid.hpp>
+#include <spotlight/utils/area_resizer.hpp>
+#include <spotlight/utils/bilinear_upscaler.hpp>
+#include <spotlight/utils/roi_utils.hpp>
 #include <spotlight/utils/image_utils.hpp>
+#include <spotlight/formats/yuv_frame.hpp>
+#include <spotlight/formats/converter.hpp>
 #include <spotlight/filters/log_filter.hpp>
 #include <spotlight/filters/lens_filter.hpp>
 #include <spotlight/filters/guided_filter.hpp>
+#include <spotlight/filters/motion_filter.hpp>
+#include <spotlight/filters/distance_filter.hpp>
 #include <spotlight/filters/gaussian_filter.hpp>
 #include <spotlight/filters/laplacian_filter.hpp>
+#include <spotlight/filters/morphology_filter.hpp>
 #include <spotlight/filters/joint_bilateral_filter.hpp>
 
 
 namespace spotlight {
 
+/**
+ * SegmType, FaceType: float, uint8_t or int8_t (tensor types of the segm
+ * and face models).
+ */
+template <typename SegmType, typename FaceType>
 class Pipeline
 {
  public:
   Pipeline(const PipelineConfig& cfg)
     : cfg(cfg),
-      segm(SEGM_MODEL, cfg.n_threads),
-      mask_filter(
-        MASK_FILTER_RADIUS,
-        segm.ModelWidth(), segm.ModelHeight(), 1
-      ),
-      edge_filter(
-        EDGE_FILTER_RADIUS,
-        segm.ModelWidth(), segm.ModelHeight(), 1
-      ),
-      blur_filter(
-        BLUR_FILTER_RADIUS,
-        BLUR_FILTER_COMPONENTS,
-        BLUR_FILTER_TRANSITION,
-        segm.ModelWidth(), segm.ModelHeight(), 3
+      segm(cfg.segm_model, cfg.InferConfig()),
+      scheduler(cfg.sched_budget, cfg.sched_still, stats),
+      // Full resolution buffers only when it is actually used
+      feather_filter(
+        cfg.mask_feather_radius,
+        cfg.mask_feather == MaskFeather::DISTANCE ? cfg.out_w : 0,
+        cfg.mask_feather == MaskFeather::DISTANCE ? cfg.out_h : 0, 1
       )
   {
-    vec_inp_segm.resize(3 * segm.ModelPixels());
-    vec_out_segm.resize(1 * segm.ModelPixels());
-    vec_mask_s.resize(1 * segm.ModelPixels());
     vec_mask_l.resize(1 * cfg.OutPixels());
-    inp_segm = vec_inp_segm.data();
-    out_segm = vec_out_segm.data();
-    mask_s = vec_mask_s.data();
     mask_l = vec_mask_l.data();
 
+    if (
+      cfg.segm_w > 0 && cfg.segm_h > 0 &&
+      !segm.resize(cfg.segm_w, cfg.segm_h)
+    )
+      throw_err(
+        "segm-model can not run at segm-w x segm-h (" +
+        std::to_string(cfg.segm_w) + "x" + std::to_string(cfg.segm_h) +
+        ")!!!"
+      );
+
+    // Slot 0 is `segm` itself, the others share its FlatBufferModel
+    for (int i = 0; cfg.segm_interpreters > 1 && i < cfg.segm_interpreters; i++)
+    {
+      auto slot = std::make_unique<SegmSlot>();
+      if (i == 0)
+      {
+        slot->segm = &segm;
+      }
+      else
+      {
+        slot->own = std::make_unique<SelfieSegmentation<SegmType>>(
+          segm, cfg.InferConfig()
+        );
+        slot->segm = slot->own.get();
+      }
+      slots.push_back(std::move(slot));
+    }
+
+    if (!cfg.segm_ref_model.empty() && !slots.empty())
+    {
+      log_err("segm-ref-model needs segm-interpreters 1, ignored!!!");
+    }
+    else if (!cfg.segm_ref_model.empty())
+    {
+      segm_ref = std::make_unique<SelfieSegmentation<float>>(
+        cfg.segm_ref_model, cfg.InferConfig()
+      );
+      segm_ref->resize(segm.ModelWidth(), segm.ModelHeight());
+      if (
+        segm_ref->ModelWidth() != segm.ModelWidth() ||
+        segm_ref->ModelHeight() != segm.ModelHeight()
+      )
+        throw_err("segm-ref-model input size differs from segm-model!!!");
+    }
+
+    if (cfg.face || cfg.mode == PipelineMode::FRAME)
+    {
+      face = std::make_unique<FaceDetection<FaceType>>(
+        FACE_TOPK, SCORE_THRESHOLD, IOU_THRESHOLD,
+        TEMPORAL_ALPHA, JERK_THRESHOLD,
+        cfg.face_model, cfg.InferConfig()
+      );
+      face_worker.emplace();
+      face_wait = cfg.face_interval - 1;
+      // The tracker wants raw detections, it does the smoothing
+      if (cfg.face_track)
+      {
+        face->setStabilize(false);
+        face_tracker.emplace(FACE_TRACK_Q, FACE_TRACK_R, FACE_TRACK_JUMP);
+      }
+    }
+
     switch (cfg.mode)
     {
       case PipelineMode::BLUR:
-        vec_blur_s.resize(3 * segm.ModelPixels());
         vec_blur_l.resize(3 * cfg.OutPixels());
-        blur_s = vec_blur_s.data();
         blur_l = vec_blur_l.data();
         break;
       case PipelineMode::IMAGE:
@@ -77,45 +149,146 @@ class Pipeline
       case PipelineMode::VIDEO:
         throw_err("PipelineMode unsupported yet!!!");
         break;
+      case PipelineMode::FRAME:
+        frame_box[2] = (float)cfg.in_w;
+        frame_box[3] = (float)cfg.in_h;
+        break;
       default:
         throw_err("Invalid PipelineMode!!!");
     }
+
+    allocSegm();
   }
 
+  /**
+   * Switches the segmentation input to w x h between two frames, e.g.
+   * 160x96 on low power machines or 320x180 on workstations. Interpreters
+   * in flight are drained, then every buffer and filter at model
+   * resolution follows and the next frame is segmented afresh. Returns
+   * false, keeping the current size, if the model can not run at w x h.
+   */
+  bool setSegmResolution(const int w, const int h)
+  {
+    if (w == segm.ModelWidth() && h == segm.ModelHeight())
+      return true;
+
+    drainSlots();
+    if (!segm.resize(w, h))
+      return false;
+
+    for (auto& slot : slots)
+    {
+      if (slot->own && !slot->own->resize(w, h))
+        throw_err("Interpreters of one model disagree on resizing!!!");
+    }
+
+    if (segm_ref && !segm_ref->resize(w, h))
+    {
+      log_err("segm-ref-model can not follow, comparison disabled!!!");
+      segm_ref.reset();
+    }
+
+    allocSegm();
+    return true;
+  }
 
-  void invoke(const uint8_t* inp_u, uint8_t* out_u)
+  /* (Re)builds everything that lives at model resolution. */
+  void allocSegm()
   {
-    spotlight::resize_bilinear(
-      inp_u, inp_segm,
-      cfg.in_w, cfg.in_h,
-      segm.ModelWidth(), segm.ModelHeight(), 3
-    );
-    spotlight::scale(
-      inp_segm, inp_segm,
-      segm.ModelWidth(), segm.ModelHeight(), 3, 1.f / 255.f
-    );
-    segm.invoke(inp_segm, out_segm);
-    spotlight::scale(
-      inp_segm, inp_segm,
-      segm.ModelWidth(), segm.ModelHeight(), 3, 255.f / 1.f
-    );
+    const int w = segm.ModelWidth();
+    const int h = segm.ModelHeight();
 
-    mask_filter.invoke(out_segm, mask_s);
-    spotlight::resize_bilinear(
-      mask_s, mask_l,
-      segm.ModelWidth(), segm.ModelHeight(),
-      cfg.out_w, cfg.out_h, 1
-    );
+    pyramid.emplace(cfg.in_w, cfg.in_h, 3, w, h);
+    mask_upscaler.emplace(w, h, cfg.out_w, cfg.out_h, 1);
+    morph_filter.emplace(cfg.mask_morph_radius, w, h, 1);
+    mask_filter.emplace(MASK_FILTER_RADIUS, w, h, 1);
+    edge_filter.emplace(EDGE_FILTER_RADIUS, w, h, 1);
+
+    vec_thumb_s.resize(3 * segm.ModelPixels());
+    vec_out_segm.resize(1 * segm.ModelPixels());
+    vec_mask_s.resize(1 * segm.ModelPixels());
+    thumb_s = vec_thumb_s.data();
+    out_segm = vec_out_segm.data();
+    mask_s = vec_mask_s.data();
+
+    roi = {0, 0, cfg.in_w, cfg.in_h};
+    segm_crop = roi;
+    roi_frames = 0;
+    if (cfg.segm_roi)
+    {
+      vec_roi_segm.resize(1 * segm.ModelPixels());
+      roi_segm = vec_roi_segm.data();
+    }
+    if (cfg.segm_roi && cfg.mode == PipelineMode::BLUR)
+    {
+      vec_blur_mask.resize(1 * segm.ModelPixels());
+      blur_mask = vec_blur_mask.data();
+    }
+
+    if (segm_ref)
+      vec_ref_segm.resize(1 * segm.ModelPixels());
+
+    if (cfg.mask_morph != MaskMorph::NONE)
+    {
+      vec_morph_s.resize(1 * segm.ModelPixels());
+      morph_s = vec_morph_s.data();
+    }
+
+    segm_wait = cfg.segm_interval - 1;
+    scheduler.reset(InferenceScheduler::SEGMENTATION);
+    slot_next = 0;
+    for (auto& slot : slots)
+    {
+      slot->mask.resize(1 * segm.ModelPixels());
+      slot->luma.resize(1 * segm.ModelPixels());
+    }
+    if (cfg.segm_interval > 1 && cfg.segm_motion)
+    {
+      motion_filter.emplace(MOTION_FILTER_RADIUS, MOTION_FILTER_BLOCK, w, h);
+      vec_luma_prev.resize(1 * segm.ModelPixels());
+      vec_luma_cur.resize(1 * segm.ModelPixels());
+      luma_prev = vec_luma_prev.data();
+      luma_cur = vec_luma_cur.data();
+    }
 
+    if (cfg.mode == PipelineMode::BLUR)
+    {
+      blur_filter.emplace(
+        BLUR_FILTER_RADIUS,
+        BLUR_FILTER_COMPONENTS,
+        BLUR_FILTER_TRANSITION,
+        w, h, 3
+      );
+      blur_upscaler.emplace(w, h, cfg.out_w, cfg.out_h, 3);
+      yuv_luma_upscaler.reset();
+      yuv_chroma_upscaler.reset();
+      vec_blur_s.resize(3 * segm.ModelPixels());
+      blur_s = vec_blur_s.data();
+    }
+  }
+
+
+  /* scaled: the camera decoded this frame into scaledTarget() too. */
+  void invoke(const uint8_t* inp_u, uint8_t* out_u, const bool scaled = false)
+  {
+    if (cfg.mode == PipelineMode::FRAME)
+    {
+      invokeFrame(inp_u, out_u);
+      return;
+    }
+
+    frame_u = inp_u;
+    pyramid_ready = false;
+    if (scaled)
+      scaledPyramid(inp_u);
+    const float* mask_m = analyze();
+
+    auto start = StageStats::clock::now();
     switch (cfg.mode)
     {
       case PipelineMode::BLUR:
-        blur_filter.invoke(inp_segm, blur_s, out_segm);
-        spotlight::resize_bilinear(
-          blur_s, blur_l,
-          segm.ModelWidth(), segm.ModelHeight(),
-          cfg.out_w, cfg.out_h, 3
-        );
+        blur_filter->invoke(thumb_s, blur_s, mask_m);
+        blur_upscaler->invoke(blur_s, blur_l);
         spotlight::alpha_blend(
           inp_u, blur_l, out_u, mask_l,
           cfg.out_w, cfg.out_h, 3
@@ -133,26 +306,1007 @@ class Pipeline
       default:
         throw_err("Invalid PipelineMode!!!");
     }
+    stats.add("compose", StageStats::since(start));
+    reportStats();
+  }
+
+  /**
+   * invoke() on YUV planes (see Converter::decodeYUV), `out` gets the
+   * layout of `inp`. Only the analysis image is converted to RGB, the
+   * blend runs on the planes: luma with the mask, chroma with the mask
+   * averaged down to chroma resolution. Not for FRAME mode.
+   */
+  void invokeYUV(const YUVFrame& inp, YUVFrame& out, const bool scaled = false)
+  {
+    if (cfg.mode == PipelineMode::FRAME)
+      throw_err("PipelineMode FRAME has no YUV path!!!");
+
+    frame_u = nullptr;
+    if (scaled)
+      scaledPyramid(nullptr);
+    else
+      buildPyramid(inp);
+    const float* mask_m = analyze();
+
+    auto start = StageStats::clock::now();
+    out.allocLike(inp);
+    chromaMask(inp);
+    const YUVFrame* bg = &yuv_bg;
+    switch (cfg.mode)
+    {
+      case PipelineMode::BLUR:
+        blur_filter->invoke(thumb_s, blur_s, mask_m);
+        yuvBlur(inp);
+        break;
+      case PipelineMode::IMAGE:
+        if (
+          yuv_bg.chroma_w != inp.chroma_w || yuv_bg.chroma_h != inp.chroma_h ||
+          yuv_bg.full_range != inp.full_range
+        )
+        {
+          yuv_bg.allocLike(inp);
+          yuv_rgb.fromRGB(bg_img, yuv_bg);
+        }
+        break;
+      case PipelineMode::VIDEO:
+        throw_err("PipelineMode unsupported yet!!!");
+        break;
+      default:
+        throw_err("Invalid PipelineMode!!!");
+    }
+
+    spotlight::alpha_blend(
+      inp.y.data(), bg->y.data(), out.y.data(), mask_l,
+      inp.width, inp.height, 1
+    );
+    spotlight::alpha_blend(
+      inp.u.data(), bg->u.data(), out.u.data(), vec_mask_c.data(),
+      inp.chroma_w, inp.chroma_h, 1
+    );
+    spotlight::alpha_blend(
+      inp.v.data(), bg->v.data(), out.v.data(), vec_mask_c.data(),
+      inp.chroma_w, inp.chroma_h, 1
+    );
+    stats.add("compose", StageStats::since(start));
+    reportStats();
+  }
+
+  /**
+   * This frame's inference and mask refinement, on the frame set up by
+   * the caller (frame_u or a prebuilt pyramid). Leaves the output
+   * resolution mask in mask_l and returns the whole frame model resolution
+   * one. A segm-roi crop mask is refined as it is and scaled straight into
+   * its part of mask_l, the whole frame mask is only pasted for the blur.
+   */
+  const float* analyze()
+  {
+    scheduler.begin();
+    if (cfg.sched_still > 0.f)
+    {
+      const ImagePyramid& pyr = framePyramid();
+      const ImagePyramid::Level& top = pyr[pyr.size() - 1];
+      scheduler.observe(top.data, top.width, top.height);
+    }
+
+    auto start = StageStats::clock::now();
+    if (
+      scheduler.decide(
+        InferenceScheduler::SEGMENTATION, segm_wait + 1 >= cfg.segm_interval
+      )
+    )
+    {
+      segm_wait = 0;
+      invokeSegm();
+      const double ms = StageStats::since(start);
+      stats.add("segm", ms);
+      scheduler.record(InferenceScheduler::SEGMENTATION, ms);
+    }
+    else
+    {
+      segm_wait++;
+      propagate();
+      stats.add("propagate", StageStats::since(start));
+    }
+
+    if (face)
+    {
+      trackFace();
+      if (scheduler.decide(InferenceScheduler::FACE_DETECTION, faceDue()))
+        scheduleFace();
+      else
+        face_wait++;
+    }
+
+    start = StageStats::clock::now();
+    // The mask is carried over to the next frames, morphology goes aside
+    const float* segm_m = cropMask();
+    const float* mask_m = segm_m;
+    switch (cfg.mask_morph)
+    {
+      case MaskMorph::NONE:
+        break;
+      case MaskMorph::ERODE:
+        morph_filter->erode(segm_m, morph_s);
+        mask_m = morph_s;
+        break;
+      case MaskMorph::DILATE:
+        morph_filter->dilate(segm_m, morph_s);
+        mask_m = morph_s;
+        break;
+      case MaskMorph::OPEN:
+        morph_filter->open(segm_m, morph_s);
+        mask_m = morph_s;
+        break;
+      case MaskMorph::CLOSE:
+        morph_filter->close(segm_m, morph_s);
+        mask_m = morph_s;
+        break;
+    }
+
+    switch (cfg.mask_feather)
+    {
+      case MaskFeather::GAUSSIAN:
+        mask_filter->invoke(mask_m, mask_s);
+        upscaleMask(mask_s);
+        break;
+      case MaskFeather::DISTANCE:
+        upscaleMask(mask_m);
+        feather_filter.invoke(mask_l, mask_l);
+        break;
+    }
+
+    if (cropped() && cfg.mode == PipelineMode::BLUR)
+    {
+      spotlight::paste_bilinear(
+        mask_m, blur_mask,
+        segm.ModelWidth(), segm.ModelHeight(),
+        cfg.in_w, cfg.in_h,
+        segm_crop.x, segm_crop.y, segm_crop.w, segm_crop.h,
+        segm.ModelWidth(), segm.ModelHeight(), 0.f
+      );
+      mask_m = blur_mask;
+    }
+    stats.add("mask", StageStats::since(start));
+    return mask_m;
   }
 
+  /* The model resolution mask into mask_l, background outside its crop. */
+  void upscaleMask(const float* mask)
+  {
+    if (!cropped())
+    {
+      mask_upscaler->invoke(mask, mask_l);
+      return;
+    }
+
+    spotlight::paste_bilinear(
+      mask, mask_l,
+      segm.ModelWidth(), segm.ModelHeight(),
+      cfg.in_w, cfg.in_h,
+      segm_crop.x, segm_crop.y, segm_crop.w, segm_crop.h,
+      cfg.out_w, cfg.out_h, 0.f
+    );
+  }
+
+  /**
+   * mask_l averaged over the luma pixels of every chroma sample (2x1 for
+   * 4:2:2, 2x2 for 4:2:0, ...) into vec_mask_c.
+   */
+  void chromaMask(const YUVFrame& f)
+  {
+    const int sx = (f.width + f.chroma_w - 1) / f.chroma_w;
+    const int sy = (f.height + f.chroma_h - 1) / f.chroma_h;
+    vec_mask_c.resize((size_t)f.chroma_w * f.chroma_h);
+    if (sx == 1 && sy == 1)
+    {
+      std::copy(mask_l, mask_l + cfg.OutPixels(), vec_mask_c.begin());
+      return;
+    }
+
+    for (int cy = 0; cy < f.chroma_h; cy++)
+    {
+      const int y0 = cy * sy;
+      const int y1 = std::min(y0 + sy, f.height);
+      float* dst = vec_mask_c.data() + (size_t)cy * f.chroma_w;
+      for (int cx = 0; cx < f.chroma_w; cx++)
+      {
+        const int x0 = cx * sx;
+        const int x1 = std::min(x0 + sx, f.width);
+        float sum = 0.f;
+        for (int y = y0; y < y1; y++)
+          for (int x = x0; x < x1; x++)
+            sum += mask_l[(size_t)y * f.width + x];
+        dst[cx] = sum / ((y1 - y0) * (x1 - x0));
+      }
+    }
+  }
+
+  /**
+   * BLUR on the YUV path: the model resolution blur goes to YUV there
+   * (a few thousand pixels) and its planes are upscaled into yuv_bg.
+   */
+  void yuvBlur(const YUVFrame& f)
+  {
+    const int mw = segm.ModelWidth();
+    const int mh = segm.ModelHeight();
+
+    yuv_bg.allocLike(f);
+    yuv_blur_s.alloc(mw, mh, mw, mh);
+    yuv_blur_s.full_range = f.full_range;
+    if (
+      !yuv_chroma_upscaler ||
+      yuv_chroma_w != f.chroma_w || yuv_chroma_h != f.chroma_h
+    )
+    {
+      yuv_luma_upscaler.emplace(mw, mh, f.width, f.height, 1);
+      yuv_chroma_upscaler.emplace(mw, mh, f.chroma_w, f.chroma_h, 1);
+      yuv_chroma_w = f.chroma_w, yuv_chroma_h = f.chroma_h;
+    }
+
+    yuv_rgb.fromRGB(blur_s, yuv_blur_s);
+    yuv_luma_upscaler->invoke(yuv_blur_s.y.data(), yuv_bg.y.data());
+    yuv_chroma_upscaler->invoke(yuv_blur_s.u.data(), yuv_bg.u.data());
+    yuv_chroma_upscaler->invoke(yuv_blur_s.v.data(), yuv_bg.v.data());
+  }
+
+  /**
+   * Pyramid level the camera may decode the next frame straight into
+   * (see Converter::decodeScaled), so that the frame is never shrunk to
+   * it: the deepest level down to 1/8. With segm-roi it is 1/2, crops
+   * need the finer levels. nullptr: not worth it (FRAME mode, a one level
+   * pyramid).
+   */
+  const ScaledTarget* scaledTarget()
+  {
+    if (cfg.mode == PipelineMode::FRAME || pyramid->size() < 2)
+      return nullptr;
+
+    scaled_level = std::min({pyramid->size() - 1, 3, cfg.segm_roi ? 1 : 3});
+    const ImagePyramid::Level& l = (*pyramid)[scaled_level];
+    scaled_target = {pyramid->writable(scaled_level), l.width, l.height};
+    return &scaled_target;
+  }
+
+  void reportStats()
+  {
+    if (++stats_frames == STATS_INTERVAL)
+    {
+      stats.report(std::cout, stats_frames);
+      stats_frames = 0;
+    }
+  }
+
+  /* Startup cost of every model the pipeline loaded, by name. */
+  std::vector<std::pair<std::string, ModelTimings>> modelTimings() const
+  {
+    std::vector<std::pair<std::string, ModelTimings>> t;
+    t.push_back({"segm", segm.Timings()});
+    for (size_t i = 1; i < slots.size(); i++)
+      t.push_back({"segm #" + std::to_string(i), slots[i]->segm->Timings()});
+    if (segm_ref)
+      t.push_back({"segm-ref", segm_ref->Timings()});
+    if (face)
+      t.push_back({"face", face->Timings()});
+    return t;
+  }
+
+  /**
+   * Part of the next camera frame that invoke() will read, for the camera
+   * to decode only that much. nullptr means the whole frame: always, except
+   * in FRAME mode between two face detections, when it is the output crop.
+   */
+  const Rect* inputRegion()
+  {
+    if (cfg.mode != PipelineMode::FRAME)
+      return nullptr;
+
+    planFrame();
+    return frame_full ? nullptr : &frame_crop;
+  }
+
+  /**
+   * Picks this frame's crop: the face box padded by FRAME_PAD_*, grown to
+   * the output aspect ratio and at most FRAME_MAX_ZOOM in. The crop moves
+   * FRAME_EASE of the way there per frame so the camera glides instead of
+   * jumping at every detection. A face detection due on this frame needs
+   * the whole frame decoded.
+   */
+  void planFrame()
+  {
+    trackFace();
+    frame_full = faceDue();
+
+    uint64_t seq = 0;
+    Detection det = getFace(&seq);
+    Rect target = {0, 0, cfg.in_w, cfg.in_h};
+    if (seq > 0)
+    {
+      det.pad(FRAME_PAD_L, FRAME_PAD_R, FRAME_PAD_U, FRAME_PAD_D);
+      target = fit_roi(
+        det.x1, det.y1, det.x2, det.y2, 0.f,
+        (float)cfg.out_w / cfg.out_h,
+        (int)(cfg.in_w / FRAME_MAX_ZOOM), (int)(cfg.in_h / FRAME_MAX_ZOOM),
+        cfg.in_w, cfg.in_h
+      );
+    }
+
+    const float goal[4] = {
+      (float)target.x, (float)target.y, (float)target.w, (float)target.h
+    };
+    for (int i = 0; i < 4; i++)
+      frame_box[i] += (goal[i] - frame_box[i]) * FRAME_EASE;
+
+    // Width on a FRAME_GRID grid, height by the box's aspect ratio: the
+    // crop keeps its size (and the resize tables) while the glide settles,
+    // rather than breathing by a pixel every frame
+    int w = (int)lrintf(frame_box[2] / FRAME_GRID) * FRAME_GRID;
+    if (frame_box[2] > cfg.in_w - FRAME_GRID)
+      w = cfg.in_w;
+    frame_crop.w = std::clamp(w, FRAME_GRID, cfg.in_w);
+    frame_crop.h = std::clamp(
+      (int)lrintf(frame_crop.w * frame_box[3] / frame_box[2]), 1, cfg.in_h
+    );
+    frame_crop.x = std::clamp((int)lrintf(frame_box[0]), 0, cfg.in_w - frame_crop.w);
+    frame_crop.y = std::clamp((int)lrintf(frame_box[1]), 0, cfg.in_h - frame_crop.h);
+    frame_planned = true;
+  }
+
+  /* FRAME mode: the planned crop of the input scaled to the output. */
+  void invokeFrame(const uint8_t* inp_u, uint8_t* out_u)
+  {
+    if (!frame_planned)
+    {
+      planFrame();
+      frame_full = true;
+    }
+    frame_planned = false;
+
+    // Face detection goes through the scheduler like in analyze(). The
+    // still check samples the whole frame, decoded when a detection is due
+    auto start = StageStats::clock::now();
+    scheduler.begin();
+    const bool due = frame_full && faceDue();
+    if (due && cfg.sched_still > 0.f)
+      scheduler.observe(inp_u, cfg.in_w, cfg.in_h);
+    if (scheduler.decide(InferenceScheduler::FACE_DETECTION, due))
+    {
+      frame_u = inp_u;
+      pyramid_ready = false;
+      scheduleFace();
+    }
+    else
+    {
+      face_wait++;
+    }
+
+    // A wide crop into a small output is averaged, not sampled
+    if (AreaResizer::Suits(frame_crop.w, frame_crop.h, cfg.out_w, cfg.out_h))
+    {
+      frame_area.invoke(
+        inp_u, cfg.in_w, frame_crop, out_u, cfg.out_w, cfg.out_h
+      );
+    }
+    else
+    {
+      spotlight::resize_bilinear_crop(
+        inp_u, out_u,
+        cfg.in_w, frame_crop.x, frame_crop.y, frame_crop.w, frame_crop.h,
+        cfg.out_w, cfg.out_h, 3
+      );
+    }
+    stats.add("frame", StageStats::since(start));
+    reportStats();
+  }
+
+  /**
+   * Once per frame: moves the tracker a frame ahead and fuses the detection
+   * the face worker published since the last call.
+   */
+  void trackFace()
+  {
+    if (!face_tracker)
+      return;
+
+    face_frames++;
+    std::lock_guard<std::mutex> lock(face_mutex);
+    face_tracker->predict();
+    if (face_fused != face_seq)
+    {
+      face_tracker->correct(face_det, (int)(face_frames - face_det_frame));
+      face_fused = face_seq;
+    }
+    if (face_tracker->Tracking())
+    {
+      face_box = face_tracker->box();
+      face_box.clamp(cfg.in_w, cfg.in_h);
+    }
+  }
+
+  /**
+   * Detections are face-interval frames apart, or face-track frames while
+   * the tracker is confident, and never overlap.
+   */
+  bool faceDue()
+  {
+    const int interval = face_tracker && face_tracker->Confident()
+                       ? cfg.face_track
+                       : cfg.face_interval;
+    return face_wait + 1 >= interval && face_worker->idle();
+  }
+
+  /**
+   * Hands the pyramid level that fits the face input to the face worker,
+   * which letterboxes it into the model (aspect ratio kept, grey bars),
+   * detects and publishes the face box (see getFace()): the raw detection
+   * with a tracker, else the stabilised one. The pipeline never waits for
+   * it: a detection still running pushes the next one to the first frame
+   * after it is done (see faceDue()).
+   */
+  void scheduleFace()
+  {
+    face_wait = 0;
+
+    // Frame size inside the model input
+    const int fw = face->ModelWidth();
+    const int fh = face->ModelHeight();
+    const int cw = std::min(fw, fh * cfg.in_w / cfg.in_h);
+    const int ch = std::min(fh, fw * cfg.in_h / cfg.in_w);
+
+    const ImagePyramid::Level& l = framePyramid().fit(cw, ch);
+    const int tw = l.width;
+    const int th = l.height;
+    vec_face_thumb.resize(3 * tw * th);
+    std::copy(l.data, l.data + 3 * tw * th, vec_face_thumb.begin());
+
+    face_worker->submit([this, tw, th, cw, ch, frame = face_frames] {
+      const auto start = StageStats::clock::now();
+      const int fw = face->ModelWidth();
+      const int fh = face->ModelHeight();
+      const int ox = (fw - cw) / 2;
+      const int oy = (fh - ch) / 2;
+
+      // Bars are mid grey, 0 after normalization
+      FaceType* tensor = face->getInputTensor();
+      const FaceType grey = spotlight::saturate_cast<FaceType>(
+        127.f * face->InputAlpha() + face->InputBeta()
+      );
+      std::fill(tensor, tensor + 3 * fw * fh, grey);
+
+      // Straight into the tensor when the rows are whole (letterbox)
+      FaceType* dst = tensor + 3 * oy * fw;
+      if (cw != fw)
+      {
+        vec_face_in.resize(3 * cw * ch);
+        dst = vec_face_in.data();
+      }
+      spotlight::resize_bilinear_crop(
+        vec_face_thumb.data(), dst,
+        tw, 0, 0, tw, th,
+        cw, ch, 3,
+        face->InputAlpha(), face->InputBeta()
+      );
+      for (int y = 0; cw != fw && y < ch; y++)
+      {
+        std::copy(
+          dst + 3 * y * cw, dst + 3 * (y + 1) * cw,
+          tensor + 3 * ((y + oy) * fw + ox)
+        );
+      }
+
+      Detection det = face->invoke();
+      det.shift((float)-ox, (float)-oy);
+      det.scale((float)cfg.in_w / cw, (float)cfg.in_h / ch);
+      det.clamp(cfg.in_w, cfg.in_h);
+
+      {
+        std::lock_guard<std::mutex> lock(face_mutex);
+        face_det = det;
+        face_det_frame = frame;
+        face_seq++;
+      }
+      const double ms = StageStats::since(start);
+      stats.add("face", ms);
+      scheduler.record(InferenceScheduler::FACE_DETECTION, ms);
+    });
+  }
+
+  /**
+   * Face box of this frame in input frame pixels (the tracker's prediction
+   * when there is one, else the latest detection) and the sequence number
+   * of the latest detection (0: none yet). Safe to call from any thread.
+   */
+  Detection getFace(uint64_t* seq = nullptr)
+  {
+    std::lock_guard<std::mutex> lock(face_mutex);
+    if (seq)
+      *seq = face_seq;
+    return face_tracker && face_tracker->Tracking() ? face_box : face_det;
+  }
+
+  /* Something reads the whole frame thumbnail. */
+  bool needThumb() const
+  {
+    return cfg.mode == PipelineMode::BLUR || segm_ref || motion_filter;
+  }
+
+
+  /* This frame's pyramid, built on first use. */
+  const ImagePyramid& framePyramid()
+  {
+    if (!pyramid_ready)
+    {
+      const auto start = StageStats::clock::now();
+      pyramid->build(frame_u);
+      pyramid_ready = true;
+      stats.add("pyramid", StageStats::since(start));
+    }
+    return *pyramid;
+  }
+
+  /**
+   * This frame's pyramid from the scaled decode already in its
+   * scaled_level (see scaledTarget()), frame: level 0 if there is one.
+   */
+  void scaledPyramid(const uint8_t* frame)
+  {
+    const auto start = StageStats::clock::now();
+    pyramid->buildFrom(scaled_level, frame);
+    pyramid_ready = true;
+    stats.add("pyramid", StageStats::since(start));
+  }
+
+  /**
+   * This frame's pyramid from YUV planes: the RGB conversion writes
+   * level 1 directly (level 0 is never made) unless the pyramid has only
+   * level 0, i.e. the frame is already about model resolution.
+   */
+  void buildPyramid(const YUVFrame& f)
+  {
+    const auto start = StageStats::clock::now();
+    if (pyramid->size() > 1)
+    {
+      const ImagePyramid::Level& l = (*pyramid)[1];
+      yuv_rgb.toRGB(f, pyramid->writable(1), l.width, l.height);
+      pyramid->buildFrom(1);
+    }
+    else
+    {
+      vec_frame_rgb.resize(3 * cfg.InpPixels());
+      yuv_rgb.toRGB(f, vec_frame_rgb.data(), cfg.in_w, cfg.in_h);
+      pyramid->build(vec_frame_rgb.data());
+    }
+    pyramid_ready = true;
+    stats.add("pyramid", StageStats::since(start));
+  }
+
+  /* Whole frame thumbnail at model resolution. */
+  void makeThumb()
+  {
+    const ImagePyramid::Level& l = framePyramid().fit(
+      segm.ModelWidth(), segm.ModelHeight()
+    );
+    spotlight::resize_bilinear(
+      l.data, thumb_s,
+      l.width, l.height,
+      segm.ModelWidth(), segm.ModelHeight(), 3
+    );
+  }
+
+  /**
+   * Model resolution luma of the `crop` of this frame, for the motion
+   * filter: the thumbnail's for the whole frame.
+   */
+  void cropLuma(const Rect& crop, uint8_t* luma)
+  {
+    const int mw = segm.ModelWidth();
+    const int mh = segm.ModelHeight();
+    if (crop.w == cfg.in_w && crop.h == cfg.in_h)
+    {
+      spotlight::rgb2gray(thumb_s, luma, mw, mh);
+      return;
+    }
+
+    Rect c = crop;
+    const ImagePyramid::Level& l = framePyramid().fit(mw, mh, c);
+    vec_crop_rgb.resize(3 * segm.ModelPixels());
+    spotlight::resize_bilinear_crop(
+      l.data, vec_crop_rgb.data(),
+      l.width, c.x, c.y, c.w, c.h,
+      mw, mh, 3
+    );
+    spotlight::rgb2gray(vec_crop_rgb.data(), luma, mw, mh);
+  }
+
+  /* Runs the model on this frame, the mask is replaced. */
+  void invokeSegm()
+  {
+    if (!slots.empty())
+    {
+      invokeSlots();
+      return;
+    }
+
+    prepare(segm.getInputTensor(), roi);
+    if (roi.w == cfg.in_w && roi.h == cfg.in_h)
+    {
+      segm.invoke(out_segm);
+      deliver(out_segm, roi);
+    }
+    else
+    {
+      segm.invoke(roi_segm);
+      deliver(roi_segm, roi);
+    }
+
+    if (segm_ref)
+      compare();
+
+    if (cfg.segm_roi)
+      updateROI(segm_crop);
+
+    if (motion_filter)
+      cropLuma(segm_crop, luma_prev);
+  }
+
+  /**
+   * segm-interpreters > 1: this frame goes to the next interpreter in turn
+   * and runs on its worker while the caller goes on. Once every worker is
+   * busy the oldest one is waited for, so masks come back in frame order,
+   * interpreters - 1 frames late. With a motion filter they are moved to
+   * the current frame, and reused frames are moved like in propagate().
+   */
+  void invokeSlots()
+  {
+    const int k = (int)slots.size();
+
+    SegmSlot& next = *slots[slot_next];
+    next.worker.wait();
+    prepare(next.segm->getInputTensor(), roi);
+    next.roi = roi;
+    if (motion_filter)
+      cropLuma(roi, next.luma.data());
+    next.worker.submit(
+      [&next] { next.segm->invoke(next.mask.data()); }
+    );
+    slot_next = (slot_next + 1) % k;
+    slots_busy++;
+
+    // Always wait for the very first mask, there is nothing to reuse yet
+    if (slots_busy == k || !slots_done)
+    {
+      SegmSlot& oldest = *slots[(slot_next - slots_busy + k) % k];
+      oldest.worker.wait();
+      slots_busy--;
+      slots_done = true;
+
+      deliver(oldest.mask.data(), oldest.roi);
+      if (cfg.segm_roi)
+        updateROI(oldest.roi);
+      if (motion_filter)
+      {
+        currentLuma(next.roi, next.luma);
+        motion_filter->invoke(
+          oldest.luma.data(), luma_cur, cropMask(), cropMask()
+        );
+      }
+    }
+    else if (motion_filter)
+    {
+      currentLuma(next.roi, next.luma);
+      motion_filter->invoke(luma_prev, luma_cur, cropMask(), cropMask());
+    }
+
+    if (motion_filter)
+      std::swap(luma_prev, luma_cur);
+  }
+
+  /* luma_cur: this frame's luma of segm_crop, reusing `luma` of `crop`. */
+  void currentLuma(const Rect& crop, const std::vector<uint8_t>& luma)
+  {
+    if (crop == segm_crop)
+      std::copy(luma.begin(), luma.end(), luma_cur);
+    else
+      cropLuma(segm_crop, luma_cur);
+  }
+
+  /* Waits for every interpreter, dropping masks still in flight. */
+  void drainSlots()
+  {
+    for (auto& slot : slots)
+      slot->worker.wait();
+    slots_busy = 0;
+    slots_done = false;
+  }
+
+  /**
+   * Model input for the `crop` of the frame, from the smallest pyramid
+   * level that still covers it at model resolution. The whole frame
+   * thumbnail is made in the same pass when the crop is the whole frame,
+   * otherwise separately and only when something reads it.
+   */
+  void prepare(SegmType* tensor, const Rect& crop)
+  {
+    const int mw = segm.ModelWidth();
+    const int mh = segm.ModelHeight();
+
+    if (crop.w == cfg.in_w && crop.h == cfg.in_h)
+    {
+      // Model input (normalized) and blur thumbnail (u8) in one pass
+      const ImagePyramid::Level& l = framePyramid().fit(mw, mh);
+      spotlight::resize_bilinear_normalize(
+        l.data, tensor, thumb_s,
+        l.width, l.height,
+        mw, mh, 3,
+        segm.InputAlpha(), segm.InputBeta()
+      );
+      return;
+    }
+
+    Rect c = crop;
+    const ImagePyramid::Level& l = framePyramid().fit(mw, mh, c);
+    spotlight::resize_bilinear_crop(
+      l.data, tensor,
+      l.width, c.x, c.y, c.w, c.h,
+      mw, mh, 3,
+      segm.InputAlpha(), segm.InputBeta()
+    );
+
+    if (needThumb())
+      makeThumb();
+  }
+
+  /**
+   * Model mask of the `crop` becomes the mask: kept as it is in
+   * cropMask(), and pasted into the whole frame out_segm (background
+   * outside the crop) for updateROI() and compare().
+   */
+  void deliver(const float* mask, const Rect& crop)
+  {
+    segm_crop = crop;
+    float* dst = cropMask();
+    if (mask != dst)
+      std::copy(mask, mask + segm.ModelPixels(), dst);
+    if (!cropped())
+      return;
+
+    spotlight::paste_bilinear(
+      mask, out_segm,
+      segm.ModelWidth(), segm.ModelHeight(),
+      cfg.in_w, cfg.in_h,
+      crop.x, crop.y, crop.w, crop.h,
+      segm.ModelWidth(), segm.ModelHeight(), 0.f
+    );
+  }
+
+  /* Whether the mask covers a segm-roi crop rather than the whole frame. */
+  bool cropped() const
+  {
+    return segm_crop.w != cfg.in_w || segm_crop.h != cfg.in_h;
+  }
+
+  /* Model resolution mask of segm_crop: roi_segm or out_segm. */
+  float* cropMask()
+  {
+    return cropped() ? roi_segm : out_segm;
+  }
+
+  /**
+   * Frames between two inferences (segm-interval > 1) reuse out_segm.
+   * With segm-motion it is first moved along the block motion of the model
+   * resolution luma since the previous frame, so mask edges stay on a
+   * moving person.
+   */
+  void propagate()
+  {
+    if (!needThumb())
+      return;
+
+    makeThumb();
+
+    if (motion_filter)
+    {
+      cropLuma(segm_crop, luma_cur);
+      motion_filter->invoke(luma_prev, luma_cur, cropMask(), cropMask());
+      std::swap(luma_prev, luma_cur);
+    }
+  }
+
+  /**
+   * Next crop: the foreground bounding box of out_segm (segmented from
+   * `crop`), padded by
+   * segm-roi-pad and grown to the frame aspect ratio (the model sees
+   * undistorted people) but never below model resolution. Goes back to the
+   * whole frame when the mask is empty, when it touches an inner edge of
+   * the crop (someone left it) and every segm-roi-refresh frames (someone
+   * new entered). A crop that still fits is kept so the input is stable.
+   */
+  void updateROI(const Rect& crop)
+  {
+    const int mw = segm.ModelWidth();
+    const int mh = segm.ModelHeight();
+    const float sx = mw > 1 ? (float)(cfg.in_w - 1) / (mw - 1) : 0.f;
+    const float sy = mh > 1 ? (float)(cfg.in_h - 1) / (mh - 1) : 0.f;
+    const Rect frame = {0, 0, cfg.in_w, cfg.in_h};
+
+    int bx0, by0, bx1, by1;
+    if (
+      !mask_bbox(out_segm, mw, mh, 0.5f, bx0, by0, bx1, by1) ||
+      (cfg.segm_roi_refresh > 0 && ++roi_frames >= cfg.segm_roi_refresh)
+    )
+    {
+      roi = frame;
+      roi_frames = 0;
+      return;
+    }
+
+    // Box in frame pixels, one mask pixel of slack on every side
+    const float x0 = (bx0 - 1) * sx, x1 = (bx1 + 1) * sx;
+    const float y0 = (by0 - 1) * sy, y1 = (by1 + 1) * sy;
+    if (
+      (crop.x > 0 && x0 <= crop.x) ||
+      (crop.y > 0 && y0 <= crop.y) ||
+      (crop.x + crop.w < cfg.in_w && x1 >= crop.x + crop.w - 1) ||
+      (crop.y + crop.h < cfg.in_h && y1 >= crop.y + crop.h - 1)
+    )
+    {
+      roi = frame;
+      roi_frames = 0;
+      return;
+    }
+
+    const Rect next = fit_roi(
+      x0, y0, x1, y1,
+      cfg.segm_roi_pad, (float)cfg.in_w / cfg.in_h,
+      mw, mh, cfg.in_w, cfg.in_h
+    );
+    if (!(roi.contains(next) && 2 * next.area() >= roi.area()))
+      roi = next;
+    if (roi == frame)
+      roi_frames = 0;
+  }
+
+  /**
+   * Runs the float reference model on the same thumbnail and reports the
+   * mean absolute mask difference and foreground IoU every 100 frames.
+   */
+  void compare()
+  {
+    spotlight::scale(
+      thumb_s, segm_ref->getInputTensor(),
+      segm.ModelWidth(), segm.ModelHeight(), 3, 1.f / 255.f
+    );
+    segm_ref->invoke(vec_ref_segm.data());
+
+    int inter = 0, uni = 0;
+    double abs_diff = 0.0;
+    for (int i = 0; i < segm.ModelPixels(); i++)
+    {
+      const bool a = out_segm[i] > 0.5f;
+      const bool b = vec_ref_segm[i] > 0.5f;
+      inter += a && b;
+      uni += a || b;
+      abs_diff += fabsf(out_segm[i] - vec_ref_segm[i]);
+    }
+    cmp_mad += abs_diff / segm.ModelPixels();
+    cmp_iou += uni ? (double)inter / uni : 1.0;
+
+    if (++cmp_frames == 100)
+    {
+      std::cout << "segm vs ref: mad " << cmp_mad / cmp_frames
+                << " iou " << cmp_iou / cmp_frames << std::endl;
+      cmp_mad = cmp_iou = 0.0;
+      cmp_frames = 0;
+    }
+  }
+
+
+  /* One interpreter of segm-interpreters and the frame it is working on. */
+  struct SegmSlot
+  {
+    std::unique_ptr<SelfieSegmentation<SegmType>> own;
+    SelfieSegmentation<SegmType>* segm;
+    Rect roi;
+    std::vector<float> mask;
+    std::vector<uint8_t> luma;
+    Worker worker;
+  };
 
   const PipelineConfig& cfg;
-  SelfieSegmentation<float> segm;
+  SelfieSegmentation<SegmType> segm;
+  std::vector<std::unique_ptr<SegmSlot>> slots;
+  int slot_next = 0;
+  int slots_busy = 0;
+  bool slots_done = false;
+  std::unique_ptr<SelfieSegmentation<float>> segm_ref;
+
+  int cmp_frames = 0;
+  double cmp_mad = 0.0;
+  double cmp_iou = 0.0;
 
-  GaussianFilter mask_filter;
-  LaplacianFilter edge_filter;
-  LensFilter blur_filter;
+  StageStats stats;
+  int stats_frames = 0;
+  InferenceScheduler scheduler;
+
+  std::unique_ptr<FaceDetection<FaceType>> face;
+  std::vector<uint8_t> vec_face_thumb;
+  std::vector<FaceType> vec_face_in;
+  std::mutex face_mutex;
+  Detection face_det = {};
+  uint64_t face_det_frame = 0;
+  uint64_t face_seq = 0;
+  int face_wait = 0;
+
+  std::optional<FaceTracker> face_tracker;
+  Detection face_box = {};
+  uint64_t face_frames = 0;
+  uint64_t face_fused = 0;
+
+  // FRAME mode: eased crop (x, y, w, h) and the crop of this frame
+  float frame_box[4] = {0.f, 0.f, 0.f, 0.f};
+  Rect frame_crop = {};
+  AreaResizer frame_area{3};
+  bool frame_full = true;
+  bool frame_planned = false;
+
+  // Model resolution, rebuilt by allocSegm()
+  std::optional<MorphologyFilter> morph_filter;
+  std::optional<GaussianFilter> mask_filter;
+  std::optional<LaplacianFilter> edge_filter;
+  std::optional<LensFilter> blur_filter;
+  std::optional<MotionFilter> motion_filter;
+  std::optional<ImagePyramid> pyramid;
+  std::optional<BilinearUpscaler> mask_upscaler;
+  std::optional<BilinearUpscaler> blur_upscaler;
+  DistanceFilter feather_filter;
+
+  // YUV path (invokeYUV): blur at model resolution (4:4:4) and background
+  // planes, sized on the first frame
+  YUVResampler yuv_rgb;
+  YUVFrame yuv_blur_s;
+  YUVFrame yuv_bg;
+  std::optional<BilinearUpscaler> yuv_luma_upscaler;
+  std::optional<BilinearUpscaler> yuv_chroma_upscaler;
+  int yuv_chroma_w = 0, yuv_chroma_h = 0;
+  std::vector<float> vec_mask_c;
+  std::vector<uint8_t> vec_frame_rgb;
+
+  // Level the camera decodes into, see scaledTarget()
+  ScaledTarget scaled_target = {};
+  int scaled_level = 1;
+
+  // Crop of the frame the model sees (segm-roi), in input pixels
+  Rect roi;
+  int roi_frames = 0;
+  // Crop the current mask covers, the roi of its inference
+  Rect segm_crop;
+
+  // Frames since the last inference
+  int segm_wait = 0;
+
+  // Frame of the current invoke() and whether its pyramid is built yet
+  const uint8_t* frame_u = nullptr;
+  bool pyramid_ready = false;
 
-  std::vector<float> vec_inp_segm;
   std::vector<float> vec_out_segm;
+  std::vector<float> vec_roi_segm;
+  std::vector<float> vec_blur_mask;
+  std::vector<float> vec_ref_segm;
+  std::vector<float> vec_morph_s;
   std::vector<float> vec_mask_s;
   std::vector<float> vec_mask_l;
+  std::vector<uint8_t> vec_thumb_s;
+  std::vector<uint8_t> vec_crop_rgb;
+  std::vector<uint8_t> vec_luma_prev;
+  std::vector<uint8_t> vec_luma_cur;
   std::vector<uint8_t> vec_bg_img;
   std::vector<uint8_t> vec_blur_s;
   std::vector<uint8_t> vec_blur_l;
 
-  float *inp_segm, *out_segm, *mask_s, *mask_l;
-  uint8_t *bg_img, *blur_s, *blur_l;
+  float *out_segm, *roi_segm, *blur_mask, *morph_s, *mask_s, *mask_l;
+  uint8_t *thumb_s, *luma_prev, *luma_cur, *bg_img, *blur_s, *blur_l;
+
+  // Last: its job uses the members above, so it must stop first
+  std::optional<Worker> face_worker;
 };
 
 } // namespace spotlight
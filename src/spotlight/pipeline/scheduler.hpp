@@ -0,0 +1,169 @@
+/**
+ * @file scheduler.hpp
+ * @author Ranjodh Singh
+ *
+ * @brief SCHEDULER.
+ *
+ * Copyright (c) 2026 Ranjodh Singh
+ * This file is licensed under the MIT License.
+ * You may obtain a copy of the License at https://opensource.org/license/MIT.
+ */
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <mutex>
+#include <cmath>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+
+#include <spotlight/utils/stats.hpp>
+
+
+namespace spotlight {
+
+/**
+ * Decides, every frame, which of the due models actually run.
+ *
+ *  - Still frames: a model is skipped while the frame's mean luma differs
+ *    from the frame it last ran on by less than `still` (0: never). Its
+ *    last result is as good as a new one.
+ *  - Staggering: face detection steps aside for one frame when
+ *    segmentation runs on the same frame.
+ *  - Budget: every frame earns `budget` ms of inference (0: no limit),
+ *    banked up to two frames. A model runs only when the bank covers its
+ *    mean cost, so an expensive model slows down instead of the frame.
+ *    Segmentation is decided first and so goes first.
+ *
+ * A model that is skipped stays due. Skips are counted in the stats as
+ * "<model>-still", "<model>-budget" and "face-stagger".
+ */
+class InferenceScheduler
+{
+ public:
+  enum Model { SEGMENTATION, FACE_DETECTION, NUM_MODELS };
+
+  InferenceScheduler(
+    const float budget,
+    const float still,
+    StageStats& stats
+  )
+    : budget(budget), still(still), stats(stats)
+  {}
+
+  /* Starts a frame. */
+  void begin()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (budget > 0.f)
+      credit = std::min(credit + budget, 2.f * budget);
+    std::fill(ran, ran + NUM_MODELS, false);
+  }
+
+  /**
+   * What this frame looks like, rgb is the whole frame at any size (e.g. a
+   * pyramid level). Only needed with `still`.
+   */
+  void observe(const uint8_t* rgb, const int width, const int height)
+  {
+    for (int y = 0; y < SIG_H; y++)
+    {
+      const int sy = (2 * y + 1) * height / (2 * SIG_H);
+      const uint8_t* row = rgb + (size_t)sy * width * 3;
+      for (int x = 0; x < SIG_W; x++)
+      {
+        const uint8_t* p = row + ((2 * x + 1) * width / (2 * SIG_W)) * 3;
+        sig[y * SIG_W + x] = (uint8_t)((p[0] + 2 * p[1] + p[2]) >> 2);
+      }
+    }
+  }
+
+  /* Whether the model runs on this frame, `due` by its own interval. */
+  bool decide(const Model m, const bool due)
+  {
+    if (!due)
+      return false;
+
+    if (still > 0.f && ref_valid[m] && change(ref[m]) < still)
+    {
+      stats.count(std::string(NAMES[m]) + "-still");
+      return false;
+    }
+
+    if (m == FACE_DETECTION && ran[SEGMENTATION] && !deferred)
+    {
+      deferred = true;
+      stats.count("face-stagger");
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (budget > 0.f && credit < std::min(cost[m], 2.f * budget))
+    {
+      stats.count(std::string(NAMES[m]) + "-budget");
+      return false;
+    }
+
+    credit -= cost[m];
+    ran[m] = true;
+    if (m == FACE_DETECTION)
+      deferred = false;
+    if (still > 0.f)
+    {
+      std::copy(sig, sig + SIG_W * SIG_H, ref[m]);
+      ref_valid[m] = true;
+    }
+    return true;
+  }
+
+  /* Cost of one run of a model, from any thread. */
+  void record(const Model m, const double ms)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    cost[m] = cost[m] > 0.f ? 0.9f * cost[m] + 0.1f * (float)ms : (float)ms;
+  }
+
+  /**
+   * The model's next due frame runs whatever the frame looks like, and its
+   * cost is measured afresh (e.g. after a change of input size).
+   */
+  void reset(const Model m)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ref_valid[m] = false;
+    cost[m] = 0.f;
+  }
+
+ private:
+  /* Mean absolute luma difference of this frame to `other`. */
+  float change(const uint8_t* other) const
+  {
+    int sum = 0;
+    for (int i = 0; i < SIG_W * SIG_H; i++)
+      sum += std::abs((int)sig[i] - (int)other[i]);
+    return (float)sum / (SIG_W * SIG_H);
+  }
+
+  // Frames are compared on a SIG_W x SIG_H grid of luma samples
+  static constexpr int SIG_W = 32;
+  static constexpr int SIG_H = 18;
+  static constexpr const char* NAMES[] = {"segm", "face"};
+
+  uint8_t sig[SIG_W * SIG_H] = {};
+  uint8_t ref[NUM_MODELS][SIG_W * SIG_H] = {};
+  bool ref_valid[NUM_MODELS] = {};
+
+  std::mutex mutex;
+  float cost[NUM_MODELS] = {};
+  float credit = 0.f;
+  bool ran[NUM_MODELS] = {};
+  bool deferred = false;
+
+  const float budget;
+  const float still;
+  StageStats& stats;
+};
+
+} // namespace spotlight
+
+#endif // SCHEDULER_HPP
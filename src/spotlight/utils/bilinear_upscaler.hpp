@@ -0,0 +1,285 @@
+/**
+ * @file bilinear_upscaler.hpp
+ * @author Ranjodh Singh
+ *
+ * @brief BILINEAR_UPSCALER.
+ *
+ * Copyright (c) 2026 Ranjodh Singh
+ * This file is licensed under the MIT License.
+ * You may obtain a copy of the License at https://opensource.org/license/MIT.
+ */
+#ifndef BILINEAR_UPSCALER_HPP
+#define BILINEAR_UPSCALER_HPP
+
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+
+namespace spotlight {
+
+/**
+ * resize_bilinear (same sample positions) for one fixed geometry, made for
+ * the model resolution -> output upscales: u8 with 1 or 3 channels and
+ * 1 channel float.
+ *
+ * Column and row taps and their 8.8 fixed-point weights are computed
+ * once. Each source row is interpolated horizontally once (into a cache of
+ * two rows), so an output row is a contiguous vertical blend of two cached
+ * rows. u8 stays in integers throughout, Q8 horizontally and Q16 after
+ * the vertical step.
+ */
+class BilinearUpscaler
+{
+ public:
+  BilinearUpscaler(
+    const int inp_w,
+    const int inp_h,
+    const int out_w,
+    const int out_h,
+    const int channels
+  )
+    : inp_w(inp_w), inp_h(inp_h), out_w(out_w), out_h(out_h),
+      channels(channels)
+  {
+    const int n = out_w * channels;
+    idx0.resize(n);
+    idx1.resize(n);
+    wx.resize(n);
+    wxf.resize(n);
+    for (int x = 0; x < out_w; x++)
+    {
+      int x0, x1, w;
+      taps(x, inp_w, out_w, x0, x1, w);
+      for (int k = 0; k < channels; k++)
+      {
+        idx0[x * channels + k] = x0 * channels + k;
+        idx1[x * channels + k] = x1 * channels + k;
+        wx[x * channels + k] = w;
+        wxf[x * channels + k] = w / 256.f;
+      }
+    }
+
+    y0.resize(out_h);
+    y1.resize(out_h);
+    wy.resize(out_h);
+    for (int y = 0; y < out_h; y++)
+      taps(y, inp_h, out_h, y0[y], y1[y], wy[y]);
+
+    wide.resize(inp_w * channels);
+    for (int i = 0; i < 2; i++)
+    {
+      rows[i].resize(n);
+      rows_f[i].resize(n);
+    }
+  }
+
+  void invoke(const uint8_t* inp, uint8_t* out)
+  {
+    const int n = out_w * channels;
+    cached[0] = cached[1] = -1;
+    for (int y = 0; y < out_h; y++)
+    {
+      const int32_t* h0 = row(inp, y0[y]);
+      const int32_t* h1 = row(inp, y1[y]);
+      const int32_t b = wy[y];
+      const int32_t a = 256 - b;
+      uint8_t* dst = out + (size_t)y * n;
+
+      int i = 0;
+#ifdef __AVX2__
+      const __m256i va = _mm256_set1_epi32(a);
+      const __m256i vb = _mm256_set1_epi32(b);
+      const __m256i half = _mm256_set1_epi32(1 << 15);
+      for (; i + 16 <= n; i += 16)
+      {
+        const __m256i lo = blend(h0 + i, h1 + i, va, vb, half);
+        const __m256i hi = blend(h0 + i + 8, h1 + i + 8, va, vb, half);
+        // 2 x 8 int32 -> 16 u8, packs work within 128 bit lanes
+        __m256i p = _mm256_permute4x64_epi64(
+          _mm256_packus_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0)
+        );
+        p = _mm256_permute4x64_epi64(
+          _mm256_packus_epi16(p, p), _MM_SHUFFLE(3, 1, 2, 0)
+        );
+        _mm_storeu_si128((__m128i*)(dst + i), _mm256_castsi256_si128(p));
+      }
+#endif
+      for (; i < n; i++)
+        dst[i] = (uint8_t)((h0[i] * a + h1[i] * b + (1 << 15)) >> 16);
+    }
+  }
+
+  /* channels == 1 */
+  void invoke(const float* inp, float* out)
+  {
+    const int n = out_w;
+    cached[0] = cached[1] = -1;
+    for (int y = 0; y < out_h; y++)
+    {
+      const float* h0 = row(inp, y0[y]);
+      const float* h1 = row(inp, y1[y]);
+      const float b = wy[y] / 256.f;
+      float* dst = out + (size_t)y * n;
+
+      int i = 0;
+#ifdef __AVX2__
+      const __m256 vb = _mm256_set1_ps(b);
+      for (; i + 8 <= n; i += 8)
+      {
+        const __m256 v0 = _mm256_loadu_ps(h0 + i);
+        const __m256 v1 = _mm256_loadu_ps(h1 + i);
+        _mm256_storeu_ps(
+          dst + i, _mm256_add_ps(v0, _mm256_mul_ps(_mm256_sub_ps(v1, v0), vb))
+        );
+      }
+#endif
+      for (; i < n; i++)
+        dst[i] = h0[i] + (h1[i] - h0[i]) * b;
+    }
+  }
+
+ private:
+  /**
+   * Taps of output i: src[i0] and src[i1] with the weight (0 - 256) of
+   * src[i1], the positions of resize_bilinear.
+   */
+  static void taps(
+    const int i,
+    const int inp_n,
+    const int out_n,
+    int& i0,
+    int& i1,
+    int& w
+  )
+  {
+    const float scale = out_n > 1 ? (float)(inp_n - 1) / (out_n - 1) : 0.f;
+    const float s = i * scale;
+    i0 = (int)floorf(s);
+    w = (int)lrintf((s - i0) * 256.f);
+    if (w == 256)
+      i0++, w = 0;
+    i0 = std::min(i0, inp_n - 1);
+    i1 = std::min(i0 + 1, inp_n - 1);
+  }
+
+  /* Source row r interpolated horizontally (Q8), from the cache if there. */
+  const int32_t* row(const uint8_t* inp, const int r)
+  {
+    const int slot = cachedSlot(r);
+    if (slot >= 0)
+      return rows[slot].data();
+
+    const int s = nextSlot(r);
+    const int m = inp_w * channels;
+    const uint8_t* src = inp + (size_t)r * m;
+    for (int i = 0; i < m; i++)
+      wide[i] = src[i];
+
+    const int n = out_w * channels;
+    int32_t* dst = rows[s].data();
+    int i = 0;
+#ifdef __AVX2__
+    const __m256i q8 = _mm256_set1_epi32(256);
+    for (; i + 8 <= n; i += 8)
+    {
+      const __m256i w = _mm256_loadu_si256((const __m256i*)(wx.data() + i));
+      const __m256i a = _mm256_i32gather_epi32(
+        wide.data(), _mm256_loadu_si256((const __m256i*)(idx0.data() + i)), 4
+      );
+      const __m256i b = _mm256_i32gather_epi32(
+        wide.data(), _mm256_loadu_si256((const __m256i*)(idx1.data() + i)), 4
+      );
+      _mm256_storeu_si256((__m256i*)(dst + i), _mm256_add_epi32(
+        _mm256_mullo_epi32(a, _mm256_sub_epi32(q8, w)),
+        _mm256_mullo_epi32(b, w)
+      ));
+    }
+#endif
+    for (; i < n; i++)
+      dst[i] = wide[idx0[i]] * (256 - wx[i]) + wide[idx1[i]] * wx[i];
+    return dst;
+  }
+
+  const float* row(const float* inp, const int r)
+  {
+    const int slot = cachedSlot(r);
+    if (slot >= 0)
+      return rows_f[slot].data();
+
+    const int s = nextSlot(r);
+    const float* src = inp + (size_t)r * inp_w;
+    float* dst = rows_f[s].data();
+    int i = 0;
+#ifdef __AVX2__
+    for (; i + 8 <= out_w; i += 8)
+    {
+      const __m256 w = _mm256_loadu_ps(wxf.data() + i);
+      const __m256 a = _mm256_i32gather_ps(
+        src, _mm256_loadu_si256((const __m256i*)(idx0.data() + i)), 4
+      );
+      const __m256 b = _mm256_i32gather_ps(
+        src, _mm256_loadu_si256((const __m256i*)(idx1.data() + i)), 4
+      );
+      _mm256_storeu_ps(
+        dst + i, _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), w))
+      );
+    }
+#endif
+    for (; i < out_w; i++)
+      dst[i] = src[idx0[i]] + (src[idx1[i]] - src[idx0[i]]) * wxf[i];
+    return dst;
+  }
+
+  int cachedSlot(const int r) const
+  {
+    return cached[0] == r ? 0 : cached[1] == r ? 1 : -1;
+  }
+
+  /* Rows are visited in order: the older one is no longer needed. */
+  int nextSlot(const int r)
+  {
+    const int s = cached[0] < cached[1] ? 0 : 1;
+    cached[s] = r;
+    return s;
+  }
+
+#ifdef __AVX2__
+  static inline __m256i blend(
+    const int32_t* h0,
+    const int32_t* h1,
+    const __m256i a,
+    const __m256i b,
+    const __m256i half
+  )
+  {
+    const __m256i v = _mm256_add_epi32(
+      _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)h0), a),
+      _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)h1), b)
+    );
+    return _mm256_srli_epi32(_mm256_add_epi32(v, half), 16);
+  }
+#endif
+
+  const int inp_w, inp_h, out_w, out_h;
+  const int channels;
+
+  // Per output column (and channel) / row: taps and weight of the 2nd tap
+  std::vector<int32_t> idx0, idx1, wx;
+  std::vector<float> wxf;
+  std::vector<int> y0, y1, wy;
+
+  std::vector<int32_t> wide;
+  std::vector<int32_t> rows[2];
+  std::vector<float> rows_f[2];
+  int cached[2] = {-1, -1};
+};
+
+} // namespace spotlight
+
+#endif // BILINEAR_UPSCALER_HPP
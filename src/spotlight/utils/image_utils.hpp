@@ -14,7 +14,9 @@
 #include <cmath>
 #include <vector>
 #include <cstdint>
+#include <limits>
 #include <algorithm>
+#include <type_traits>
 #include <spotlight/utils/error_utils.hpp>
 
 
@@ -40,6 +42,24 @@ inline T clamp_branchless(
   );
 }
 
+/* Rounds and saturates for integral T, plain cast otherwise. */
+template <typename T>
+inline T saturate_cast(const float x)
+{
+  if constexpr (std::is_integral_v<T>)
+  {
+    return (T)std::clamp(
+      lrintf(x),
+      (long)std::numeric_limits<T>::min(),
+      (long)std::numeric_limits<T>::max()
+    );
+  }
+  else
+  {
+    return (T)x;
+  }
+}
+
 template <typename T>
 inline size_t frame_size(
   const int width,
@@ -247,7 +267,7 @@ inline void resize_bilinear(
   {
       const float xs = x * scaleX;
       X0[x] = (int)floorf(xs);
-      X1[x] = (int)ceilf(xs);
+      X1[x] = std::min((int)ceilf(xs), inp_width - 1);
       XF[x] = xs - X0[x];
   }
 
@@ -256,7 +276,7 @@ inline void resize_bilinear(
   {
     const float ys = y * scaleY;
     const int y0 = (int)floorf(ys);
-    const int y1 = (int)ceilf(ys);
+    const int y1 = std::min((int)ceilf(ys), inp_height - 1);
     const float yf = ys - y0;
 
     const iT* col0 = inp + y0 * inp_width * channels;
@@ -282,6 +302,220 @@ inline void resize_bilinear(
   }
 }
 
+/**
+ * resize_bilinear into two outputs in one pass: out_n gets the sample
+ * mapped by `alpha * v + beta` (e.g. 1/255, or a quantization, straight
+ * into a model input tensor) and out_u gets it rounded to uint8_t (e.g. a
+ * thumbnail for the blur).
+ */
+template <typename iT, typename nT>
+inline void resize_bilinear_normalize(
+  const iT* inp,
+  nT* out_n,
+  uint8_t* out_u,
+  const int inp_width,
+  const int inp_height,
+  const int out_width,
+  const int out_height,
+  const int channels,
+  const float alpha,
+  const float beta = 0.f
+)
+{
+  const float scaleX = (
+    out_width > 1 ? (float)(inp_width - 1) / (out_width - 1) : 0.f
+  );
+  const float scaleY = (
+    out_height > 1 ? (float)(inp_height - 1) / (out_height - 1) : 0.f
+  );
+
+  std::vector<int> X0(out_width);
+  std::vector<int> X1(out_width);
+  std::vector<float> XF(out_width);
+  for (int x = 0; x < out_width; x++)
+  {
+      const float xs = x * scaleX;
+      X0[x] = (int)floorf(xs);
+      X1[x] = std::min((int)ceilf(xs), inp_width - 1);
+      XF[x] = xs - X0[x];
+  }
+
+  nT* dst_n = out_n;
+  uint8_t* dst_u = out_u;
+  for (int y = 0; y < out_height; y++)
+  {
+    const float ys = y * scaleY;
+    const int y0 = (int)floorf(ys);
+    const int y1 = std::min((int)ceilf(ys), inp_height - 1);
+    const float yf = ys - y0;
+
+    const iT* col0 = inp + y0 * inp_width * channels;
+    const iT* col1 = inp + y1 * inp_width * channels;
+    for (int x = 0; x < out_width; x++)
+    {
+      const int x0 = X0[x];
+      const int x1 = X1[x];
+      const float xf = XF[x];
+
+      const iT* p00 = col0 + x0 * channels;
+      const iT* p10 = col0 + x1 * channels;
+      const iT* p01 = col1 + x0 * channels;
+      const iT* p11 = col1 + x1 * channels;
+      for (int c = 0; c < channels; c++)
+      {
+        const float i0 = p00[c] + (p10[c] - p00[c]) * xf;
+        const float i1 = p01[c] + (p11[c] - p01[c]) * xf;
+        const float val = i0 + (i1 - i0) * yf;
+
+        *(dst_n++) = saturate_cast<nT>(val * alpha + beta);
+        *(dst_u++) = (uint8_t)std::clamp(val + 0.5f, 0.f, 255.f);
+      }
+    }
+  }
+}
+
+/**
+ * resize_bilinear of the crop_w x crop_h window at (crop_x, crop_y) of a
+ * frame `inp_width` pixels wide, mapped by `alpha * v + beta`.
+ */
+template <typename iT, typename oT>
+inline void resize_bilinear_crop(
+  const iT* inp,
+  oT* out,
+  const int inp_width,
+  const int crop_x,
+  const int crop_y,
+  const int crop_w,
+  const int crop_h,
+  const int out_width,
+  const int out_height,
+  const int channels,
+  const float alpha = 1.f,
+  const float beta = 0.f
+)
+{
+  const float scaleX = (
+    out_width > 1 ? (float)(crop_w - 1) / (out_width - 1) : 0.f
+  );
+  const float scaleY = (
+    out_height > 1 ? (float)(crop_h - 1) / (out_height - 1) : 0.f
+  );
+
+  std::vector<int> X0(out_width);
+  std::vector<int> X1(out_width);
+  std::vector<float> XF(out_width);
+  for (int x = 0; x < out_width; x++)
+  {
+      const float xs = x * scaleX;
+      X0[x] = crop_x + (int)floorf(xs);
+      X1[x] = crop_x + std::min((int)ceilf(xs), crop_w - 1);
+      XF[x] = xs - floorf(xs);
+  }
+
+  oT* dst = out;
+  for (int y = 0; y < out_height; y++)
+  {
+    const float ys = y * scaleY;
+    const int y0 = crop_y + (int)floorf(ys);
+    const int y1 = crop_y + std::min((int)ceilf(ys), crop_h - 1);
+    const float yf = ys - floorf(ys);
+
+    const iT* col0 = inp + y0 * inp_width * channels;
+    const iT* col1 = inp + y1 * inp_width * channels;
+    for (int x = 0; x < out_width; x++)
+    {
+      const float xf = XF[x];
+      const iT* p00 = col0 + X0[x] * channels;
+      const iT* p10 = col0 + X1[x] * channels;
+      const iT* p01 = col1 + X0[x] * channels;
+      const iT* p11 = col1 + X1[x] * channels;
+      for (int c = 0; c < channels; c++)
+      {
+        const float i0 = p00[c] + (p10[c] - p00[c]) * xf;
+        const float i1 = p01[c] + (p11[c] - p01[c]) * xf;
+
+        *(dst++) = saturate_cast<oT>((i0 + (i1 - i0) * yf) * alpha + beta);
+      }
+    }
+  }
+}
+
+/**
+ * Inverse of resize_bilinear_crop for a 1 channel map: `roi` (roi_width x
+ * roi_height) covers the crop of an inp_width x inp_height frame, `out`
+ * (out_width x out_height) covers the whole frame. Pixels outside the crop
+ * get `fill`.
+ */
+template <typename T>
+inline void paste_bilinear(
+  const T* roi,
+  T* out,
+  const int roi_width,
+  const int roi_height,
+  const int inp_width,
+  const int inp_height,
+  const int crop_x,
+  const int crop_y,
+  const int crop_w,
+  const int crop_h,
+  const int out_width,
+  const int out_height,
+  const T fill
+)
+{
+  // out pixel -> frame pixel -> roi pixel
+  const float frameX = (
+    out_width > 1 ? (float)(inp_width - 1) / (out_width - 1) : 0.f
+  );
+  const float frameY = (
+    out_height > 1 ? (float)(inp_height - 1) / (out_height - 1) : 0.f
+  );
+  const float roiX = crop_w > 1 ? (float)(roi_width - 1) / (crop_w - 1) : 0.f;
+  const float roiY = crop_h > 1 ? (float)(roi_height - 1) / (crop_h - 1) : 0.f;
+
+  std::vector<int> X0(out_width);
+  std::vector<float> XF(out_width);
+  for (int x = 0; x < out_width; x++)
+  {
+    const float xs = (x * frameX - crop_x) * roiX;
+    X0[x] = (xs < 0.f || xs > roi_width - 1) ? -1 : (int)floorf(xs);
+    XF[x] = xs - floorf(xs);
+  }
+
+  T* dst = out;
+  for (int y = 0; y < out_height; y++)
+  {
+    const float ys = (y * frameY - crop_y) * roiY;
+    if (ys < 0.f || ys > roi_height - 1)
+    {
+      std::fill(dst, dst + out_width, fill);
+      dst += out_width;
+      continue;
+    }
+    const int y0 = (int)floorf(ys);
+    const int y1 = std::min(y0 + 1, roi_height - 1);
+    const float yf = ys - y0;
+
+    const T* row0 = roi + y0 * roi_width;
+    const T* row1 = roi + y1 * roi_width;
+    for (int x = 0; x < out_width; x++)
+    {
+      const int x0 = X0[x];
+      if (x0 < 0)
+      {
+        *(dst++) = fill;
+        continue;
+      }
+      const int x1 = std::min(x0 + 1, roi_width - 1);
+      const float xf = XF[x];
+
+      const float i0 = row0[x0] + (row0[x1] - row0[x0]) * xf;
+      const float i1 = row1[x0] + (row1[x1] - row1[x0]) * xf;
+      *(dst++) = saturate_cast<T>(i0 + (i1 - i0) * yf);
+    }
+  }
+}
+
 } // namespace spotlight
 
 #endif // IMAGE_UTILS_HPP
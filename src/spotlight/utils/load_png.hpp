@@ -13,8 +13,10 @@
 
 #include <spng.h>
 #include <stdexcept>
+#include <type_traits>
 
 #include <spotlight/utils/image_utils.hpp>
+#include <spotlight/utils/area_resizer.hpp>
 
 #define SPNG_CHUNK_LIMIT    64 * 1024 * 1024
 
@@ -66,9 +68,24 @@ void load_PNG(
     if (spng_decode_image(ctx, image, size, SPNG_FMT_RGB8, 0))
       throw std::runtime_error("Failed spng_decode_image!");
 
-    resize_bilinear(
-      image, buffer, ihdr.width, ihdr.height, width, height, channels
-    );
+    bool done = false;
+    if constexpr (std::is_same_v<T, uint8_t>)
+    {
+      if (AreaResizer::Suits(ihdr.width, ihdr.height, width, height))
+      {
+        AreaResizer(channels).invoke(
+          image, ihdr.width, {0, 0, (int)ihdr.width, (int)ihdr.height},
+          buffer, width, height
+        );
+        done = true;
+      }
+    }
+    if (!done)
+    {
+      resize_bilinear(
+        image, buffer, ihdr.width, ihdr.height, width, height, channels
+      );
+    }
   }
   catch (...)
   {
@@ -0,0 +1,74 @@
+/**
+ * @file mapped_file.hpp
+ * @author Ranjodh Singh
+ *
+ * @brief MAPPED_FILE.
+ *
+ * Copyright (c) 2026 Ranjodh Singh
+ * This file is licensed under the MIT License.
+ * You may obtain a copy of the License at https://opensource.org/license/MIT.
+ */
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <spotlight/utils/error_utils.hpp>
+
+
+namespace spotlight {
+
+/**
+ * Read-only, shared mapping of a whole file.
+ * Every mapping of the same file shares the page cache pages.
+ */
+class MappedFile
+{
+ public:
+  MappedFile(const std::string& path)
+    : path(path)
+  {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      throw_errno("Failed to open: " + path);
+
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+      close(fd);
+      throw_errno("Failed to stat: " + path);
+    }
+    length = (size_t)st.st_size;
+
+    ptr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+      throw_errno("Failed to mmap: " + path);
+  }
+
+  ~MappedFile()
+  {
+    if (ptr != MAP_FAILED && munmap(ptr, length) < 0)
+      log_errno("Failed to munmap: " + path);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* data() const { return (const char*)ptr; }
+  size_t size() const { return length; }
+
+ private:
+  void* ptr = MAP_FAILED;
+  size_t length = 0;
+  const std::string path;
+};
+
+} // namespace spotlight
+
+#endif // MAPPED_FILE_HPP
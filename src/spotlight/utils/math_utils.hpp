@@ -0,0 +1,114 @@
+/**
+ * @file math_utils.hpp
+ * @author Ranjodh Singh
+ *
+ * @brief MATH_UTILS.
+ *
+ * Copyright (c) 2026 Ranjodh Singh
+ * This file is licensed under the MIT License.
+ * You may obtain a copy of the License at https://opensource.org/license/MIT.
+ */
+#ifndef MATH_UTILS_HPP
+#define MATH_UTILS_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+
+namespace spotlight {
+
+/**
+ * Cephes style expf: x = n * ln2 + g with |g| <= ln2 / 2, e^g from a
+ * degree 6 polynomial and 2^n written straight into the exponent bits.
+ * Relative error is ~2e-7 over the clamped range [-87, 88].
+ */
+namespace fast_exp_consts {
+  static constexpr float lo = -87.3f;
+  static constexpr float hi = 88.3f;
+  static constexpr float log2e = 1.44269504088896341f;
+  static constexpr float ln2_hi = 0.693359375f;
+  static constexpr float ln2_lo = -2.12194440e-4f;
+  static constexpr float p0 = 1.9875691500e-4f;
+  static constexpr float p1 = 1.3981999507e-3f;
+  static constexpr float p2 = 8.3334519073e-3f;
+  static constexpr float p3 = 4.1665795894e-2f;
+  static constexpr float p4 = 1.6666665459e-1f;
+  static constexpr float p5 = 5.0000001201e-1f;
+} // namespace fast_exp_consts
+
+inline float fast_exp(float x)
+{
+  using namespace fast_exp_consts;
+
+  x = std::clamp(x, lo, hi);
+  const float n = nearbyintf(x * log2e);
+  const float g = (x - n * ln2_hi) - n * ln2_lo;
+
+  float p = p0;
+  p = p * g + p1;
+  p = p * g + p2;
+  p = p * g + p3;
+  p = p * g + p4;
+  p = p * g + p5;
+  const float eg = p * g * g + g + 1.f;
+
+  const int32_t bits = ((int32_t)n + 127) << 23;
+  float pow2n;
+  std::memcpy(&pow2n, &bits, sizeof(pow2n));
+  return eg * pow2n;
+}
+
+/* 1 / (1 + e^-x) */
+inline float fast_sigmoid(const float x)
+{
+  return 1.f / (1.f + fast_exp(-x));
+}
+
+#ifdef __AVX2__
+// Plain mul / add: -mavx2 alone does not enable FMA.
+inline __m256 fast_exp(__m256 x)
+{
+  using namespace fast_exp_consts;
+
+  x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(lo)), _mm256_set1_ps(hi));
+  const __m256 n = _mm256_round_ps(
+    _mm256_mul_ps(x, _mm256_set1_ps(log2e)),
+    _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC
+  );
+  __m256 g = _mm256_sub_ps(x, _mm256_mul_ps(n, _mm256_set1_ps(ln2_hi)));
+  g = _mm256_sub_ps(g, _mm256_mul_ps(n, _mm256_set1_ps(ln2_lo)));
+
+  __m256 p = _mm256_set1_ps(p0);
+  p = _mm256_add_ps(_mm256_mul_ps(p, g), _mm256_set1_ps(p1));
+  p = _mm256_add_ps(_mm256_mul_ps(p, g), _mm256_set1_ps(p2));
+  p = _mm256_add_ps(_mm256_mul_ps(p, g), _mm256_set1_ps(p3));
+  p = _mm256_add_ps(_mm256_mul_ps(p, g), _mm256_set1_ps(p4));
+  p = _mm256_add_ps(_mm256_mul_ps(p, g), _mm256_set1_ps(p5));
+  const __m256 eg = _mm256_add_ps(
+    _mm256_add_ps(_mm256_mul_ps(p, _mm256_mul_ps(g, g)), g),
+    _mm256_set1_ps(1.f)
+  );
+
+  const __m256i bits = _mm256_slli_epi32(
+    _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23
+  );
+  return _mm256_mul_ps(eg, _mm256_castsi256_ps(bits));
+}
+
+inline __m256 fast_sigmoid(const __m256 x)
+{
+  const __m256 one = _mm256_set1_ps(1.f);
+  const __m256 e = fast_exp(_mm256_sub_ps(_mm256_setzero_ps(), x));
+  return _mm256_div_ps(one, _mm256_add_ps(one, e));
+}
+#endif
+
+} // namespace spotlight
+
+#endif // MATH_UTILS_HPP
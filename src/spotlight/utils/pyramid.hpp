@@ -0,0 +1,193 @@
+/**
+ * @file pyramid.hpp
+ * @author Ranjodh Singh
+ *
+ * @brief PYRAMID.
+ *
+ * Copyright (c) 2026 Ranjodh Singh
+ * This file is licensed under the MIT License.
+ * You may obtain a copy of the License at https://opensource.org/license/MIT.
+ */
+#ifndef PYRAMID_HPP
+#define PYRAMID_HPP
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include <spotlight/utils/roi_utils.hpp>
+
+
+namespace spotlight {
+
+/**
+ * Image pyramid of one u8 frame, rebuilt every frame.
+ *
+ * Level 0 is the frame itself (not copied), every level above is the 2x2
+ * box average of the one below, down to the smallest size any consumer
+ * needs (min_w x min_h). A consumer takes the smallest level that is still
+ * as large as what it needs and finishes with one bilinear step, so all
+ * analysis together reads the full resolution frame once.
+ */
+class ImagePyramid
+{
+ public:
+  struct Level
+  {
+    const uint8_t* data;
+    int width;
+    int height;
+  };
+
+  ImagePyramid(
+    const int width,
+    const int height,
+    const int channels,
+    const int min_w,
+    const int min_h
+  )
+    : channels(channels)
+  {
+    levels.push_back({nullptr, width, height});
+    while (
+      levels.back().width / 2 >= std::max(1, min_w) &&
+      levels.back().height / 2 >= std::max(1, min_h)
+    )
+    {
+      const Level& prev = levels.back();
+      levels.push_back({nullptr, prev.width / 2, prev.height / 2});
+    }
+
+    buffers.resize(levels.size());
+    for (size_t i = 1; i < levels.size(); i++)
+    {
+      buffers[i].resize((size_t)levels[i].width * levels[i].height * channels);
+      levels[i].data = buffers[i].data();
+    }
+    row.resize((size_t)width * channels);
+  }
+
+  void build(const uint8_t* frame)
+  {
+    levels[0].data = frame;
+    for (size_t i = 1; i < levels.size(); i++)
+      halve(levels[i - 1], buffers[i].data());
+  }
+
+  /**
+   * Builds from level `first` (> 0) on, which the caller has written into
+   * writable(first), e.g. by a scaled decode or from YUV planes. Level 0
+   * is `frame` when there is one, the levels in between are unavailable
+   * and fit() goes around them.
+   */
+  void buildFrom(const int first, const uint8_t* frame = nullptr)
+  {
+    levels[0].data = frame;
+    for (int i = 1; i < first; i++)
+      levels[i].data = nullptr;
+    for (size_t i = first + 1; i < levels.size(); i++)
+      halve(levels[i - 1], buffers[i].data());
+  }
+
+  uint8_t* writable(const int i) { return buffers[i].data(); }
+
+  /* Smallest level at least w x h (level 0 when none is). */
+  const Level& fit(const int w, const int h) const
+  {
+    int i = 0;
+    while (
+      i + 1 < (int)levels.size() &&
+      levels[i + 1].width >= w && levels[i + 1].height >= h
+    )
+      i++;
+    return levels[available(i)];
+  }
+
+  /**
+   * Smallest level on which the level 0 `crop` is still at least w x h;
+   * `crop` is rewritten in that level's pixels.
+   */
+  const Level& fit(const int w, const int h, Rect& crop) const
+  {
+    int i = 0;
+    while (
+      i + 1 < (int)levels.size() &&
+      (crop.w >> (i + 1)) >= w && (crop.h >> (i + 1)) >= h
+    )
+      i++;
+    i = available(i);
+
+    crop = {crop.x >> i, crop.y >> i, crop.w >> i, crop.h >> i};
+    return levels[i];
+  }
+
+  const Level& operator[](const int i) const { return levels[i]; }
+  int size() const { return (int)levels.size(); }
+
+ private:
+  /**
+   * Level i if built, else the nearest built one: a finer one first (more
+   * resolution than needed), else a coarser one.
+   */
+  int available(const int i) const
+  {
+    for (int j = i; j >= 0; j--)
+      if (levels[j].data)
+        return j;
+    for (int j = i + 1; j < (int)levels.size(); j++)
+      if (levels[j].data)
+        return j;
+    return i;
+  }
+
+  /* 2x2 box average of inp into out, an odd last row / column is dropped. */
+  void halve(const Level& inp, uint8_t* out)
+  {
+    const int c = channels;
+    const int out_w = inp.width / 2;
+    const int out_h = inp.height / 2;
+    const int n = 2 * out_w * c;
+
+    for (int y = 0; y < out_h; y++)
+    {
+      const uint8_t* r0 = inp.data + (size_t)(2 * y) * inp.width * c;
+      const uint8_t* r1 = r0 + (size_t)inp.width * c;
+
+      // Vertical pair sums, then horizontal pairs of those
+      int i = 0;
+#ifdef __AVX2__
+      for (; i + 16 <= n; i += 16)
+      {
+        const __m256i a = _mm256_cvtepu8_epi16(
+          _mm_loadu_si128((const __m128i*)(r0 + i))
+        );
+        const __m256i b = _mm256_cvtepu8_epi16(
+          _mm_loadu_si128((const __m128i*)(r1 + i))
+        );
+        _mm256_storeu_si256((__m256i*)(row.data() + i), _mm256_add_epi16(a, b));
+      }
+#endif
+      for (; i < n; i++)
+        row[i] = (uint16_t)(r0[i] + r1[i]);
+
+      uint8_t* o = out + (size_t)y * out_w * c;
+      const uint16_t* s = row.data();
+      for (int x = 0; x < out_w; x++, s += 2 * c, o += c)
+        for (int k = 0; k < c; k++)
+          o[k] = (uint8_t)((s[k] + s[k + c] + 2) >> 2);
+    }
+  }
+
+  const int channels;
+  std::vector<Level> levels;
+  std::vector<std::vector<uint8_t>> buffers;
+  std::vector<uint16_t> row;
+};
+
+} // namespace spotlight
+
+#endif // PYRAMID_HPP
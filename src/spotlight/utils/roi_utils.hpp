@@ -0,0 +1,125 @@
+/**
+ * @file roi_utils.hpp
+ * @author Ranjodh Singh
+ *
+ * @brief ROI_UTILS.
+ *
+ * Copyright (c) 2026 Ranjodh Singh
+ * This file is licensed under the MIT License.
+ * You may obtain a copy of the License at https://opensource.org/license/MIT.
+ */
+#ifndef ROI_UTILS_HPP
+#define ROI_UTILS_HPP
+
+#include <cmath>
+#include <algorithm>
+
+
+namespace spotlight {
+
+/* Integer pixel rectangle, [x, x + w) x [y, y + h). */
+struct Rect
+{
+  int x, y, w, h;
+
+  int area() const { return w * h; }
+
+  bool contains(const Rect& o) const
+  {
+    return (
+      o.x >= x && o.y >= y &&
+      o.x + o.w <= x + w && o.y + o.h <= y + h
+    );
+  }
+
+  bool operator==(const Rect& o) const
+  {
+    return x == o.x && y == o.y && w == o.w && h == o.h;
+  }
+};
+
+/**
+ * Inclusive bounding box of the pixels above `threshold`.
+ * Returns false (box untouched) when there are none.
+ */
+template <typename T>
+inline bool mask_bbox(
+  const T* mask,
+  const int width,
+  const int height,
+  const T threshold,
+  int& x0, int& y0, int& x1, int& y1
+)
+{
+  int bx0 = width, by0 = height, bx1 = -1, by1 = -1;
+  for (int y = 0; y < height; y++)
+  {
+    const T* row = mask + y * width;
+    int l = 0;
+    while (l < width && !(row[l] > threshold))
+      l++;
+    if (l == width)
+      continue;
+    int r = width - 1;
+    while (!(row[r] > threshold))
+      r--;
+
+    bx0 = std::min(bx0, l);
+    bx1 = std::max(bx1, r);
+    by0 = std::min(by0, y);
+    by1 = y;
+  }
+
+  if (bx1 < 0)
+    return false;
+  x0 = bx0, y0 = by0, x1 = bx1, y1 = by1;
+  return true;
+}
+
+/**
+ * Box (x0, y0) - (x1, y1) padded by `pad` of its size on every side, grown
+ * to `aspect` (w / h) and to at least min_w x min_h, then shifted inside
+ * the frame. Returns the whole frame when it does not fit.
+ */
+inline Rect fit_roi(
+  float x0, float y0, float x1, float y1,
+  const float pad,
+  const float aspect,
+  const int min_w,
+  const int min_h,
+  const int frame_w,
+  const int frame_h
+)
+{
+  const float pw = (x1 - x0) * pad;
+  const float ph = (y1 - y0) * pad;
+  x0 -= pw, x1 += pw;
+  y0 -= ph, y1 += ph;
+
+  float w = x1 - x0;
+  float h = y1 - y0;
+  if (w < h * aspect)
+    w = h * aspect;
+  else
+    h = w / aspect;
+
+  const float s = std::max({1.f, min_w / w, min_h / h});
+  w *= s, h *= s;
+
+  if (w >= frame_w || h >= frame_h)
+    return {0, 0, frame_w, frame_h};
+
+  const int iw = (int)ceilf(w);
+  const int ih = (int)ceilf(h);
+  const int ix = (int)lrintf((x0 + x1 - w) * 0.5f);
+  const int iy = (int)lrintf((y0 + y1 - h) * 0.5f);
+  return {
+    std::clamp(ix, 0, frame_w - iw),
+    std::clamp(iy, 0, frame_h - ih),
+    iw, ih
+  };
+}
+
+} // namespace spotlight
+
+#endif // ROI_UTILS_HPP
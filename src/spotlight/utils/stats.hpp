@@ -0,0 +1,92 @@
+/**
+ * @file stats.hpp
+ * @author Ranjodh Singh
+ *
+ * @brief STATS.
+ *
+ * Copyright (c) 2026 Ranjodh Singh
+ * This file is licensed under the MIT License.
+ * You may obtain a copy of the License at https://opensource.org/license/MIT.
+ */
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iomanip>
+#include <ostream>
+
+
+namespace spotlight {
+
+/**
+ * Mean cost of each pipeline stage, fed from any thread. Stages are
+ * printed in the order they were first seen, report() also resets them.
+ */
+class StageStats
+{
+ public:
+  using clock = std::chrono::steady_clock;
+
+  static double since(const clock::time_point& start)
+  {
+    return std::chrono::duration<double, std::milli>(
+      clock::now() - start
+    ).count();
+  }
+
+  void add(const std::string& stage, const double ms)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Stage& s : stages)
+    {
+      if (s.name == stage)
+      {
+        s.total_ms += ms;
+        s.runs++;
+        return;
+      }
+    }
+    stages.push_back({stage, ms, 1});
+  }
+
+  /* Counts an event (e.g. a skipped stage) without a cost. */
+  void count(const std::string& event)
+  {
+    add(event, 0.0);
+  }
+
+  void report(std::ostream& os, const int frames)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    os << "stages over " << frames << " frames:" << std::fixed
+       << std::setprecision(2);
+    for (Stage& s : stages)
+    {
+      os << " " << s.name;
+      if (s.total_ms > 0.0)
+        os << " " << s.total_ms / s.runs << " ms";
+      os << " x" << s.runs;
+      s.total_ms = 0.0;
+      s.runs = 0;
+    }
+    os << std::defaultfloat << std::endl;
+  }
+
+ private:
+  struct Stage
+  {
+    std::string name;
+    double total_ms;
+    int runs;
+  };
+
+  std::mutex mutex;
+  std::vector<Stage> stages;
+};
+
+} // namespace spotlight
+
+#endif // STATS_HPP
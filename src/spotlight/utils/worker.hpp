@@ -0,0 +1,113 @@
+/**
+ * @file worker.hpp
+ * @author Ranjodh Singh
+ *
+ * @brief WORKER.
+ *
+ * Copyright (c) 2026 Ranjodh Singh
+ * This file is licensed under the MIT License.
+ * You may obtain a copy of the License at https://opensource.org/license/MIT.
+ */
+#ifndef WORKER_HPP
+#define WORKER_HPP
+
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+
+namespace spotlight {
+
+/**
+ * One thread running one job at a time.
+ * submit() waits for the previous job; wait() rethrows what a job threw.
+ */
+class Worker
+{
+ public:
+  Worker()
+  {
+    thread = std::thread([this] { loop(); });
+  }
+
+  ~Worker()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    cv.notify_all();
+    thread.join();
+  }
+
+  Worker(const Worker&) = delete;
+  Worker& operator=(const Worker&) = delete;
+
+  void submit(std::function<void()> fn)
+  {
+    wait();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      job = std::move(fn);
+      busy = true;
+    }
+    cv.notify_all();
+  }
+
+  void wait()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return !busy; });
+    if (error)
+      std::rethrow_exception(std::exchange(error, nullptr));
+  }
+
+  bool idle()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !busy;
+  }
+
+ private:
+  void loop()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+      cv.wait(lock, [this] { return busy || stop; });
+      if (!busy)
+        return;
+
+      std::function<void()> fn = std::move(job);
+      lock.unlock();
+      try
+      {
+        fn();
+      }
+      catch (...)
+      {
+        lock.lock();
+        error = std::current_exception();
+        lock.unlock();
+      }
+      lock.lock();
+      busy = false;
+      cv.notify_all();
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::function<void()> job;
+  std::exception_ptr error;
+  bool busy = false;
+  bool stop = false;
+  std::thread thread;
+};
+
+} // namespace spotlight
+
+#endif // WORKER_HPP
@@ -12,6 +12,7 @@
 #define V4L2_CAM_HPP
 
 #include <memory>
+#include <optional>
 
 #include <sys/ioctl.h>
 #include <linux/videodev2.h>
@@ -19,6 +20,7 @@
 #include <spotlight/v4l2/v4l2.hpp>
 #include <spotlight/formats/yuyv.hpp>
 #include <spotlight/formats/jpeg.hpp>
+#include <spotlight/utils/worker.hpp>
 
 
 namespace spotlight {
@@ -46,7 +48,7 @@ class V4L2Camera
         break;
       case (V4L2_PIX_FMT_MJPEG):
         converter = std::make_unique<ConverterJPEG>(
-          config.width, config.height, 95
+          config.width, config.height, 95, config.codec_threads
         );
         break;
       default:
@@ -55,7 +57,90 @@ class V4L2Camera
     }
   }
 
-  void invoke(void* data)
+  /**
+   * region: decode only this part of the frame (nullptr: all of it).
+   * scaled: also decode the whole frame at its size (see decodeScaled).
+   * Returns whether `scaled` was filled.
+   */
+  bool invoke(
+    void* data,
+    const Rect* region = nullptr,
+    const ScaledTarget* scaled = nullptr
+  )
+  {
+    bool filled = false;
+    dequeue([&](const uint8_t* ptr, size_t buf_len) {
+      filled = decodeBoth(ptr, buf_len, scaled, [&] {
+        if (region)
+          converter->decodeRegion(ptr, (uint8_t*)data, buf_len, *region);
+        else
+          converter->decode(ptr, (uint8_t*)data, buf_len);
+      });
+    });
+    return filled;
+  }
+
+  /* Next frame as YUV planes, see Converter::decodeYUV and invoke(). */
+  bool invokeYUV(YUVFrame& frame, const ScaledTarget* scaled = nullptr)
+  {
+    bool filled = false;
+    dequeue([&](const uint8_t* ptr, size_t buf_len) {
+      filled = decodeBoth(ptr, buf_len, scaled, [&] {
+        converter->decodeYUV(ptr, frame, buf_len);
+      });
+    });
+    return filled;
+  }
+
+  /**
+   * Runs `decode` and, on scale_worker next to it, the scaled decode of
+   * the same buffer. Both are done when it returns.
+   */
+  template <typename Fn>
+  bool decodeBoth(
+    const uint8_t* ptr,
+    const size_t buf_len,
+    const ScaledTarget* scaled,
+    Fn&& decode
+  )
+  {
+    if (!scaled || !converter->ScaledDecode())
+    {
+      decode();
+      return false;
+    }
+
+    if (!scale_worker)
+      scale_worker.emplace();
+
+    bool filled = false;
+    scale_worker->submit([&] {
+      filled = converter->decodeScaled(ptr, buf_len, *scaled);
+    });
+    try
+    {
+      decode();
+    }
+    catch (...)
+    {
+      // The job reads the buffer, it must be done before it is requeued.
+      // Its own error, if any, is dropped for this one.
+      try
+      {
+        scale_worker->wait();
+      }
+      catch (...)
+      {
+      }
+      throw;
+    }
+    scale_worker->wait();
+    return filled;
+  }
+
+  /* Hands the next filled buffer (data, bytes used) to `read`. */
+  template <typename Fn>
+  void dequeue(Fn&& read)
   {
     v4l2_buffer buffer{};
     buffer.type = BUF_TYPE;
@@ -67,12 +152,7 @@ class V4L2Camera
         "Failed VIDIOC_DQBUF in v4l2 device" + dev.device_path
       );
 
-    size_t buf_len = buffer.bytesused;
-    converter->decode(
-      (uint8_t*)dev.buffers[buffer.index].ptr,
-      (uint8_t*)data,
-      buf_len
-    );
+    read((const uint8_t*)dev.buffers[buffer.index].ptr, (size_t)buffer.bytesused);
 
     if (ioctl(dev.fd, VIDIOC_QBUF, &buffer) < 0)
       throw std::runtime_error(
@@ -82,6 +162,7 @@ class V4L2Camera
 
   Device dev;
   std::unique_ptr<Converter> converter;
+  std::optional<Worker> scale_worker;
 };
 
 } // namespace spotlight
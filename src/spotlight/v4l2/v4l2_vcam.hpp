@@ -55,7 +55,7 @@ class V4L2VirtualCamera
         break;
       case (V4L2_PIX_FMT_MJPEG):
         converter = std::make_unique<ConverterJPEG>(
-          config.width, config.height, 95
+          config.width, config.height, 95, config.codec_threads
         );
         break;
       default:
@@ -65,6 +65,26 @@ class V4L2VirtualCamera
   }
 
   void invoke(void* data)
+  {
+    enqueue([&](uint8_t* ptr, size_t* buf_len) {
+      converter->encode((uint8_t*)data, ptr, buf_len);
+    });
+  }
+
+  /* Writes YUV planes, see Converter::encodeYUV. */
+  void invokeYUV(const YUVFrame& frame)
+  {
+    enqueue([&](uint8_t* ptr, size_t* buf_len) {
+      converter->encodeYUV(frame, ptr, buf_len);
+    });
+  }
+
+  /**
+   * Has `write` fill the next free buffer (data, in: its length, out: bytes
+   * used) and queues it on the frame clock.
+   */
+  template <typename Fn>
+  void enqueue(Fn&& write)
   {
     v4l2_buffer buffer{};
     buffer.type = BUF_TYPE;
@@ -91,11 +111,7 @@ class V4L2VirtualCamera
 		// }
 
     size_t buf_len = dev.buffers[buffer.index].length;
-    converter->encode(
-      (uint8_t*)data,
-      (uint8_t*)dev.buffers[buffer.index].ptr,
-      &buf_len
-    );
+    write((uint8_t*)dev.buffers[buffer.index].ptr, &buf_len);
     buffer.bytesused = buf_len;
 
     if (ioctl(dev.fd, VIDIOC_QBUF, &buffer) < 0)